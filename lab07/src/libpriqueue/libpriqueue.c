@@ -6,38 +6,106 @@
 
 #include "libpriqueue.h"
 
+#define POOL_MIN_SLAB 64
+#define POOL_MAX_SLAB 65536
+
+// Node pool helper methods
+
+void pool_init (node_pool_t *pool) {
+  pool->free_list = NULL;
+  pool->free_tail = NULL;
+  pool->slabs = NULL;
+  pool->capacity = 0;
+  pool->next_slab_size = POOL_MIN_SLAB;
+}
+
+// mallocs one slab of count nodes and pushes them all onto the free list
+static void pool_add_slab (node_pool_t *pool, int count) {
+  node_slab_t *slab = malloc(sizeof(node_slab_t) + sizeof(node_t) * count);
+  slab->count = count;
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+
+  if (pool->free_list == NULL) pool->free_tail = &slab->nodes[count - 1];
+  for (int i = count - 1; i >= 0; i--) {
+    slab->nodes[i].next = pool->free_list;
+    pool->free_list = &slab->nodes[i];
+  }
+  pool->capacity += count;
+}
+
+void pool_reserve (node_pool_t *pool, int capacity) {
+  if (capacity > pool->capacity) pool_add_slab(pool, capacity - pool->capacity);
+}
+
+void pool_merge (node_pool_t *dst, node_pool_t *src) {
+  if (src->slabs == NULL) return;
+
+  // src's slabs (a handful, since they double in size) go in front of dst's
+  node_slab_t *last = src->slabs;
+  while (last->next != NULL) last = last->next;
+  last->next = dst->slabs;
+  dst->slabs = src->slabs;
+
+  // and its unused nodes join the end of the free list
+  if (src->free_list != NULL) {
+    if (dst->free_list == NULL) dst->free_list = src->free_list;
+    else dst->free_tail->next = src->free_list;
+    dst->free_tail = src->free_tail;
+  }
+
+  dst->capacity += src->capacity;
+  if (src->next_slab_size > dst->next_slab_size) dst->next_slab_size = src->next_slab_size;
+  pool_init(src);
+}
+
+void pool_destroy (node_pool_t *pool) {
+  node_slab_t *slab = pool->slabs;
+  while (slab != NULL) {
+    node_slab_t *next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  pool_init(pool);
+}
+
 // Node helper methods
 
-node_t *new_node (void *item, node_t *next) {
-  node_t * node = malloc(sizeof(node_t));
+node_t *new_node (node_pool_t *pool, void *item, node_t *next) {
+  if (pool->free_list == NULL) {
+    pool_add_slab(pool, pool->next_slab_size);
+    if (pool->next_slab_size < POOL_MAX_SLAB) pool->next_slab_size *= 2;
+  }
+
+  node_t * node = pool->free_list;
+  pool->free_list = node->next;
+  if (pool->free_list == NULL) pool->free_tail = NULL;
   node->item = item;
   node->next = next;
   return node;
 }
 
-void *destroy_node (node_t *node) {
+void *destroy_node (node_pool_t *pool, node_t *node) {
   if (node == NULL) return NULL;
 
   void *item = node->item;
-  free(node);
+  if (pool->free_list == NULL) pool->free_tail = node;
+  node->next = pool->free_list;
+  pool->free_list = node;
   return item;
 }
 
-void destroy_list (node_t *node) {
-  if (node == NULL) return;
-
-  destroy_list(node->next);
-  free(node);
-}
-
 node_t *node_at (node_t *node, int index) {
-  if (index < 0 || node == NULL) return NULL;
+  if (index < 0) return NULL;
 
-  return index == 0 ? node : node_at(node->next, index - 1);
+  while (node != NULL && index-- > 0) node = node->next;
+  return node;
 }
 
 int list_size(node_t *node) {
-  return node == NULL ? 0 : 1 + list_size(node->next);
+  int size = 0;
+  for (; node != NULL; node = node->next) size++;
+  return size;
 }
 
 
@@ -52,9 +120,266 @@ int list_size(node_t *node) {
   See also @ref comparer-page
  */
 void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
+{
+  priqueue_init_backend(q, comparer, PRIQUEUE_LIST);
+}
+
+
+/**
+  Initializes the priqueue_t data structure with an explicit storage backend.
+
+  PRIQUEUE_LIST keeps a sorted linked list: O(n) offer, O(1) poll, O(index) priqueue_at.
+  PRIQUEUE_HEAP keeps an array-backed binary heap: O(log n) offer and poll, but
+  priqueue_at/priqueue_remove_at cost O(index * log(index)) since the heap is only
+  partially ordered.
+  PRIQUEUE_TREE keeps an order-statistic treap: offer (including the returned
+  index), poll, priqueue_at and priqueue_remove_at are all O(log n) expected.
+  PRIQUEUE_MINMAX keeps a min-max heap: like PRIQUEUE_HEAP, but priqueue_peek_max
+  is O(1) and priqueue_poll_max O(log n); priqueue_at/priqueue_remove_at are
+  O(1)/O(log n) at either end and sort a snapshot, O(n log n), in between.
+  PRIQUEUE_PAIRING keeps a pairing heap: O(1) offer, O(log n) amortized poll,
+  and priqueue_merge of two pairing queues in O(1); priqueue_at beyond the
+  head sorts a snapshot, O(n log n).
+  PRIQUEUE_BUCKET needs an integer key instead of a comparer; see priqueue_init_bucket.
+  PRIQUEUE_HEAP and PRIQUEUE_MINMAX can order by a cached key instead of a
+  comparer; see priqueue_init_keyed.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements (see priqueue_init)
+  @param backend the storage layout to use for this queue
+ */
+void priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend)
 {
   q->comparer = comparer;
+  q->backend = backend;
+  q->next_seq = 0;
+  q->size = 0;
   q->top = NULL;
+  q->tail = NULL;
+  pool_init(&q->pool);
+  q->stats = (priqueue_stats_t){0};
+  q->stats_paused = 0;
+  q->heap = NULL;
+  q->heap_capacity = 0;
+  q->keyed = 0;
+  q->sort_key = NULL;
+  q->root = NULL;
+  q->tree_seed = 2463534242u;
+  q->key = NULL;
+  q->buckets = NULL;
+  q->bucket_count = 0;
+  q->min_key = 0;
+  q->max_key = 0;
+}
+
+
+/**
+  Initializes the priqueue_t data structure as a bucket queue (PRIQUEUE_BUCKET).
+
+  Elements are ordered by key(element), lowest first, and elements with the
+  same key by arrival. The queue keeps one bucket per key between the lowest
+  and highest queued key, so keys must span a small range: priorities, or
+  arrival times of the jobs in a system at once. When keys are offered in
+  non-decreasing order (arrival times), offer and poll are amortized O(1);
+  otherwise poll may scan the key range once. An element's key must not change
+  while it is queued, except through priqueue_update.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param key a function pointer that maps an element to its integer priority (lower is higher priority)
+ */
+void priqueue_init_bucket(priqueue_t *q, int(*key)(const void *))
+{
+  priqueue_init_backend(q, NULL, PRIQUEUE_BUCKET);
+  q->key = key;
+}
+
+
+/**
+  Initializes a PRIQUEUE_HEAP or PRIQUEUE_MINMAX queue ordered by a cached key.
+
+  Elements are ordered by sort_key(element), lowest first, and elements with
+  the same key by arrival. The key is computed once when the element is
+  offered (or passed in by priqueue_offer_key) and stored in the element's
+  heap slot, so sifting compares integers in the slot array instead of
+  calling a comparer that dereferences both elements. Pack compound orders
+  into the 64 bits, e.g. (long long)primary * (1LL << 32) + secondary for a
+  32-bit primary (which may be negative) and a non-negative secondary. An
+  element's key must not change while it is queued, except through
+  priqueue_update, which recomputes it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param sort_key a function pointer that maps an element to its key (lower is higher priority)
+  @param backend PRIQUEUE_HEAP or PRIQUEUE_MINMAX
+ */
+void priqueue_init_keyed(priqueue_t *q, long long(*sort_key)(const void *), priqueue_backend_t backend)
+{
+  priqueue_init_backend(q, NULL, backend);
+  q->keyed = 1;
+  q->sort_key = sort_key;
+}
+
+
+/**
+  Initializes the priqueue_t data structure and fills it with n elements at once.
+
+  Equivalent to priqueue_init_backend followed by priqueue_offer_many: the
+  elements are queued as if offered in array order, in O(n) for PRIQUEUE_HEAP
+  and PRIQUEUE_MINMAX (heapify) and O(n log n) for PRIQUEUE_LIST and
+  PRIQUEUE_TREE (one sort), rather than n separate offers. For PRIQUEUE_BUCKET,
+  call priqueue_init_bucket and then priqueue_offer_many.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param comparer a function pointer that compares two elements (see priqueue_init)
+  @param backend the storage layout to use for this queue
+  @param items the elements to queue
+  @param n the number of elements in items
+ */
+void priqueue_init_from_array(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend, void **items, int n)
+{
+  priqueue_init_backend(q, comparer, backend);
+  priqueue_offer_many(q, items, n);
+}
+
+
+// calls the comparer, counting the call
+static inline int compare(priqueue_t *q, const void *a, const void *b)
+{
+  PRIQUEUE_COUNT(q, comparisons, 1);
+  return q->comparer(a, b);
+}
+
+// counts n offers & the size they brought the queue to
+static inline void count_offers(priqueue_t *q, int n)
+{
+#ifdef PRIQUEUE_STATS
+  if (q->stats_paused) return;
+  q->stats.offers += n;
+  if (q->size > q->stats.max_size) q->stats.max_size = q->size;
+#else
+  (void)q;
+  (void)n;
+#endif
+}
+
+// places node in front of target (or at the end when target is NULL)
+static void list_insert_before(priqueue_t *q, node_t *node, node_t *target)
+{
+  node->next = target;
+  node->prev = target == NULL ? q->tail : target->prev;
+  if (node->prev != NULL) node->prev->next = node;
+  else q->top = node;
+  if (target != NULL) target->prev = node;
+  else q->tail = node;
+
+  q->size++;
+}
+
+// links node into the list after every element of equal priority & returns its index
+static int list_link(priqueue_t *q, node_t *node)
+{
+  int i = 0;
+  node_t *target = NULL;
+
+  // fast path: node sorts after the current tail (e.g. monotone arrival times),
+  // or the queue is empty
+  if (q->tail == NULL || compare(q, node->item, q->tail->item) >= 0) {
+    i = q->size;
+  }
+  // otherwise, iterate over the queue list; the tail check above guarantees
+  // node is placed before the end of the list
+  else {
+    target = q->top;
+    for (; compare(q, node->item, target->item) >= 0; ++i) target = target->next;
+    PRIQUEUE_COUNT(q, nodes_walked, i);
+  }
+
+  list_insert_before(q, node, target);
+  return i;
+}
+
+// merges items, already in priority order, into the list in a single pass
+static void list_link_sorted(priqueue_t *q, void **items, int n)
+{
+  node_t *target = q->top;
+
+  // later items never sort before earlier ones, so the walk never restarts
+  for (int i = 0; i < n; i++) {
+    while (target != NULL && compare(q, items[i], target->item) >= 0) {
+      PRIQUEUE_COUNT(q, nodes_walked, 1);
+      target = target->next;
+    }
+    list_insert_before(q, new_node(&q->pool, items[i], NULL), target);
+  }
+}
+
+// unlinks node from the list in O(1) (the node is not released)
+static void list_unlink(priqueue_t *q, node_t *node)
+{
+  if (node->prev != NULL) node->prev->next = node->next;
+  else q->top = node->next;
+  if (node->next != NULL) node->next->prev = node->prev;
+  else q->tail = node->prev;
+
+  q->size--;
+}
+
+// moves node to its new sorted position, walking only as far as its key moved
+static void list_relink(priqueue_t *q, node_t *node)
+{
+  node_t *target;
+
+  // sorts later now: skip forward past everything at or before it
+  if (node->next != NULL && compare(q, node->item, node->next->item) >= 0) {
+    target = node->next;
+    list_unlink(q, node);
+    while (target != NULL && compare(q, node->item, target->item) >= 0) {
+      PRIQUEUE_COUNT(q, nodes_walked, 1);
+      target = target->next;
+    }
+  }
+  // sorts earlier now: walk backward past everything after it
+  else if (node->prev != NULL && compare(q, node->item, node->prev->item) < 0) {
+    target = node->prev;
+    list_unlink(q, node);
+    while (target->prev != NULL && compare(q, node->item, target->prev->item) < 0) {
+      PRIQUEUE_COUNT(q, nodes_walked, 1);
+      target = target->prev;
+    }
+  }
+  else return;
+
+  list_insert_before(q, node, target);
+}
+
+
+// unlinks the element node refers to & releases the node (uncounted, see priqueue_remove_handle)
+static void *release_node(priqueue_t *q, node_t *node)
+{
+  if (q->backend == PRIQUEUE_HEAP) return heap_remove_handle(q, node);
+  if (q->backend == PRIQUEUE_MINMAX) return minmax_remove_handle(q, node);
+
+  if (q->backend == PRIQUEUE_TREE) tree_unlink(q, node);
+  else if (q->backend == PRIQUEUE_BUCKET) bucket_unlink(q, node);
+  else if (q->backend == PRIQUEUE_PAIRING) pairing_unlink(q, node);
+  else list_unlink(q, node);
+  return destroy_node(&q->pool, node);
+}
+
+// removes the index'th element (uncounted, see priqueue_remove_at)
+static void *remove_at(priqueue_t *q, int index)
+{
+  if (q->backend == PRIQUEUE_HEAP) return heap_remove_at(q, index);
+  if (q->backend == PRIQUEUE_MINMAX) return minmax_remove_at(q, index);
+
+  node_t *remove;
+  if (q->backend == PRIQUEUE_TREE) remove = tree_at(q, index);
+  else if (q->backend == PRIQUEUE_BUCKET) remove = bucket_at(q, index);
+  else if (q->backend == PRIQUEUE_PAIRING) remove = pairing_at(q, index);
+  else {
+    remove = node_at(q->top, index);
+    if (remove != NULL) PRIQUEUE_COUNT(q, nodes_walked, index);
+  }
+  return remove == NULL ? NULL : release_node(q, remove);
 }
 
 
@@ -64,43 +389,144 @@ void priqueue_init(priqueue_t *q, int(*comparer)(const void *, const void *))
   @param q a pointer to an instance of the priqueue_t data structure
   @param ptr a pointer to the data to be inserted into the priority queue
   @return The zero-based index where ptr is stored in the priority queue, where 0 indicates that ptr was stored at the front of the priority queue.
+  For PRIQUEUE_HEAP this is the heap slot instead, and for PRIQUEUE_BUCKET and
+  PRIQUEUE_MINMAX/PAIRING it is 0 or 1; all are 0 exactly when ptr is the new front.
  */
 int priqueue_offer(priqueue_t *q, void *ptr)
 {
-  // special case: if queue is empty, just insert the value at top
-  if (q->top == NULL) {
-    node_t *node = new_node(ptr, NULL);
-    q->top = node;
-    return 0;
+  int index;
+  if (q->backend == PRIQUEUE_HEAP) index = heap_offer(q, ptr, NULL, heap_key(q, ptr));
+  else if (q->backend == PRIQUEUE_TREE) index = tree_link(q, new_node(&q->pool, ptr, NULL));
+  else if (q->backend == PRIQUEUE_BUCKET) index = bucket_link(q, new_node(&q->pool, ptr, NULL));
+  else if (q->backend == PRIQUEUE_MINMAX) index = minmax_offer(q, ptr, NULL, heap_key(q, ptr));
+  else if (q->backend == PRIQUEUE_PAIRING) index = pairing_link(q, new_node(&q->pool, ptr, NULL));
+  else index = list_link(q, new_node(&q->pool, ptr, NULL));
+
+  count_offers(q, 1);
+  return index;
+}
+
+
+/**
+  Insert the specified element into a keyed priority queue under a key the
+  caller has already computed (see priqueue_init_keyed), saving the call to
+  sort_key. The key must be the one sort_key would return for ptr.
+
+  @param q a pointer to a priqueue_t initialized with priqueue_init_keyed
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @param key the sort key of ptr
+  @return as for priqueue_offer
+  @return -1 (and ptr is not queued) if q is not a keyed PRIQUEUE_HEAP or PRIQUEUE_MINMAX queue
+ */
+int priqueue_offer_key(priqueue_t *q, void *ptr, long long key)
+{
+  if (!q->keyed || (q->backend != PRIQUEUE_HEAP && q->backend != PRIQUEUE_MINMAX)) return -1;
+
+  int index;
+  if (q->backend == PRIQUEUE_MINMAX) index = minmax_offer(q, ptr, NULL, key);
+  else index = heap_offer(q, ptr, NULL, key);
+
+  count_offers(q, 1);
+  return index;
+}
+
+
+/**
+  Insert the specified element into this priority queue and return a handle to it.
+
+  The handle stays valid until the element leaves the queue (through poll,
+  remove, remove_at or priqueue_remove_handle) and lets the caller remove
+  that one entry without searching for it.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+  @return the node holding ptr
+ */
+node_t *priqueue_offer_handle(priqueue_t *q, void *ptr)
+{
+  node_t *node = new_node(&q->pool, ptr, NULL);
+
+  if (q->backend == PRIQUEUE_HEAP) heap_offer(q, ptr, node, heap_key(q, ptr));
+  else if (q->backend == PRIQUEUE_MINMAX) minmax_offer(q, ptr, node, heap_key(q, ptr));
+  else if (q->backend == PRIQUEUE_TREE) tree_link(q, node);
+  else if (q->backend == PRIQUEUE_BUCKET) bucket_link(q, node);
+  else if (q->backend == PRIQUEUE_PAIRING) pairing_link(q, node);
+  else list_link(q, node);
+
+  count_offers(q, 1);
+  return node;
+}
+
+
+// mallocs a copy of items in priority order (a stable bottom-up merge sort)
+static void **sort_items(priqueue_t *q, void **items, int n)
+{
+  void **sorted = malloc(sizeof(void *) * n);
+  void **scratch = malloc(sizeof(void *) * n);
+
+  for (int i = 0; i < n; i++) sorted[i] = items[i];
+  for (int width = 1; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2 * width) {
+      int mid = lo + width < n ? lo + width : n;
+      int hi = lo + 2 * width < n ? lo + 2 * width : n;
+      int a = lo, b = mid, k = lo;
+      while (a < mid && b < hi)
+        scratch[k++] = compare(q, sorted[b], sorted[a]) < 0 ? sorted[b++] : sorted[a++];
+      while (a < mid) scratch[k++] = sorted[a++];
+      while (b < hi) scratch[k++] = sorted[b++];
+    }
+    void **swap = sorted;
+    sorted = scratch;
+    scratch = swap;
   }
 
-  // otherwise, iterate over the queue list
-  int i = 0;
-  node_t *prev = NULL;
-  node_t *target = q->top;
+  free(scratch);
+  return sorted;
+}
 
-  for (; target != NULL; ++i) {
-    if(q->comparer(ptr, target->item) < 0) {
-      node_t *node = new_node(ptr, target);
 
-      // if we are placing at start of list, point q->top to this new node
-      if(i == 0) {
-        q->top = node;
-      }
-      // otherwise, point prev->next to the new node
-      else {
-        prev->next = node;
-      }
-      return i;
+/**
+  Inserts n elements into this priority queue at once.
+
+  The result is the same as offering items[0], items[1], ... in turn, but the
+  batch is placed in one pass: PRIQUEUE_LIST sorts it once and merges it into
+  the list (O(n log n + size) instead of O(n * size)), PRIQUEUE_TREE builds an
+  empty tree in O(n) after the sort, and PRIQUEUE_HEAP/MINMAX re-heapify in
+  O(size) when the batch is larger than the queue. Node storage is reserved
+  up front.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param items the elements to insert
+  @param n the number of elements in items
+ */
+void priqueue_offer_many(priqueue_t *q, void **items, int n)
+{
+  if (n <= 0) return;
+
+  if (q->backend == PRIQUEUE_HEAP) {
+    heap_offer_many(q, items, n);
+  }
+  else if (q->backend == PRIQUEUE_MINMAX) {
+    minmax_offer_many(q, items, n);
+  }
+  // bucket and pairing offers are already O(1), no sort needed
+  else if (q->backend == PRIQUEUE_BUCKET || q->backend == PRIQUEUE_PAIRING) {
+    pool_reserve(&q->pool, q->size + n);
+    for (int i = 0; i < n; i++) {
+      node_t *node = new_node(&q->pool, items[i], NULL);
+      if (q->backend == PRIQUEUE_BUCKET) bucket_link(q, node);
+      else pairing_link(q, node);
     }
-    prev = target;
-    target = target->next;
+  }
+  else {
+    pool_reserve(&q->pool, q->size + n);
+    void **sorted = sort_items(q, items, n);
+    if (q->backend == PRIQUEUE_TREE) tree_link_sorted(q, sorted, n);
+    else list_link_sorted(q, sorted, n);
+    free(sorted);
   }
 
-  // if wasn't placed, place item at end
-  node_t *node = new_node(ptr, target);
-  prev->next = node;
-	return i;
+  count_offers(q, n);
 }
 
 
@@ -128,7 +554,68 @@ void *priqueue_peek(priqueue_t *q)
  */
 void *priqueue_poll(priqueue_t *q)
 {
-  return priqueue_remove_at(q, 0);
+  void *item = remove_at(q, 0);
+  if (item != NULL) PRIQUEUE_COUNT(q, polls, 1);
+  return item;
+}
+
+
+/**
+  Retrieves, but does not remove, the tail of this queue (the element
+  priqueue_poll would return last), returning NULL if this queue is empty.
+
+  O(1) for PRIQUEUE_LIST and PRIQUEUE_MINMAX, O(log n) for PRIQUEUE_TREE,
+  amortized O(1) for PRIQUEUE_BUCKET, O(n) for PRIQUEUE_HEAP and O(n log n)
+  for PRIQUEUE_PAIRING.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return pointer to element at the tail of the queue
+  @return NULL if the queue is empty
+ */
+void *priqueue_peek_max(priqueue_t *q)
+{
+  if (q->backend == PRIQUEUE_HEAP) return heap_peek_max(q);
+  if (q->backend == PRIQUEUE_MINMAX) return minmax_peek_max(q);
+
+  node_t *node;
+  if (q->backend == PRIQUEUE_TREE) node = tree_last(q);
+  else if (q->backend == PRIQUEUE_BUCKET) node = bucket_last(q);
+  else if (q->backend == PRIQUEUE_PAIRING) node = pairing_at(q, q->size - 1);
+  else node = q->tail;
+  return node == NULL ? NULL : node->item;
+}
+
+
+/**
+  Retrieves and removes the tail of this queue, or NULL if this queue
+  is empty.
+
+  Costs as priqueue_peek_max, except PRIQUEUE_MINMAX, which is O(log n).
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the tail of this queue
+  @return NULL if this queue is empty
+ */
+void *priqueue_poll_max(priqueue_t *q)
+{
+  void *item;
+  if (q->backend == PRIQUEUE_HEAP) {
+    item = heap_poll_max(q);
+  }
+  else if (q->backend == PRIQUEUE_MINMAX) {
+    item = minmax_poll_max(q);
+  }
+  else {
+    node_t *node;
+    if (q->backend == PRIQUEUE_TREE) node = tree_last(q);
+    else if (q->backend == PRIQUEUE_BUCKET) node = bucket_last(q);
+    else if (q->backend == PRIQUEUE_PAIRING) node = pairing_at(q, q->size - 1);
+    else node = q->tail;
+    item = node == NULL ? NULL : release_node(q, node);
+  }
+
+  if (item != NULL) PRIQUEUE_COUNT(q, polls, 1);
+  return item;
 }
 
 
@@ -145,7 +632,22 @@ void *priqueue_poll(priqueue_t *q)
  */
 void *priqueue_at(priqueue_t *q, int index)
 {
-	node_t * node = q->top == NULL ? NULL : node_at(q->top, index);
+  if (q->backend == PRIQUEUE_HEAP) return heap_at(q, index);
+  if (q->backend == PRIQUEUE_MINMAX) return minmax_at(q, index);
+
+  if (q->backend == PRIQUEUE_BUCKET || q->backend == PRIQUEUE_PAIRING) {
+    node_t *node = q->backend == PRIQUEUE_BUCKET ? bucket_at(q, index) : pairing_at(q, index);
+    return node == NULL ? NULL : node->item;
+  }
+
+  node_t *node;
+  if (q->backend == PRIQUEUE_TREE) {
+    node = tree_at(q, index);
+  }
+  else {
+    node = node_at(q->top, index);
+    if (node != NULL) PRIQUEUE_COUNT(q, nodes_walked, index);
+  }
   return node == NULL ? NULL : node->item;
 }
 
@@ -154,6 +656,7 @@ void *priqueue_at(priqueue_t *q, int index)
   Removes all instances of ptr from the queue. 
   
   This function should not use the comparer function, but check if the data contained in each element of the queue is equal (==) to ptr.
+  It always scans the whole queue; use priqueue_remove_handle to remove one known entry.
  
   @param q a pointer to an instance of the priqueue_t data structure
   @param ptr address of element to be removed
@@ -161,32 +664,91 @@ void *priqueue_at(priqueue_t *q, int index)
  */
 int priqueue_remove(priqueue_t *q, void *ptr)
 {
-  
   int removed = 0;
-  node_t *target = q->top;
-  node_t *prev = NULL;
 
-  while (target != NULL) {
-    if(target->item == ptr) { // TODO: compare by pointer or value?
-      // special case: if target == q->top, must re-assign q->top to next element
-      if (target == q->top) q->top = q->top->next;
+  if (q->backend == PRIQUEUE_HEAP) removed = heap_remove(q, ptr);
+  else if (q->backend == PRIQUEUE_MINMAX) removed = minmax_remove(q, ptr);
+  else if (q->backend == PRIQUEUE_TREE) removed = tree_remove(q, ptr);
+  else if (q->backend == PRIQUEUE_BUCKET) removed = bucket_remove(q, ptr);
+  else if (q->backend == PRIQUEUE_PAIRING) removed = pairing_remove(q, ptr);
+  else {
+    node_t *target = q->top;
 
-      if (prev != NULL) prev->next = target->next;
-      node_t *remove = target;
-      target = target->next;
-      destroy_node(remove);
-      removed++;
-    }
-    else {
-      prev = target;
-      target = target->next;
+    while (target != NULL) {
+      node_t *next = target->next;
+      if(target->item == ptr) {
+        list_unlink(q, target);
+        destroy_node(&q->pool, target);
+        removed++;
+      }
+      target = next;
     }
   }
 
+  PRIQUEUE_COUNT(q, removes, removed);
   return removed;
 }
 
 
+/**
+  Removes the element referred to by handle from the queue.
+
+  Unlike priqueue_remove this touches only the one entry: O(1) for
+  PRIQUEUE_LIST and PRIQUEUE_BUCKET and O(log n) for PRIQUEUE_HEAP,
+  PRIQUEUE_TREE and PRIQUEUE_MINMAX (amortized for PRIQUEUE_PAIRING),
+  regardless of queue length.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle a handle returned by priqueue_offer_handle for an element still in q
+  @return the element removed from the queue
+ */
+void *priqueue_remove_handle(priqueue_t *q, node_t *handle)
+{
+  PRIQUEUE_COUNT(q, removes, 1);
+  return release_node(q, handle);
+}
+
+
+/**
+  Restores the ordering of the queue after the priority of the element
+  referred to by handle has changed.
+
+  The element is treated as freshly offered: it is placed after any
+  elements that now have the same priority. This replaces a
+  priqueue_remove_handle + priqueue_offer_handle round trip and keeps the
+  handle valid. O(1) for PRIQUEUE_BUCKET, O(log n) for PRIQUEUE_HEAP,
+  PRIQUEUE_TREE and PRIQUEUE_MINMAX; for PRIQUEUE_LIST the cost is the
+  distance the element moves.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param handle a handle returned by priqueue_offer_handle for an element still in q
+ */
+void priqueue_update(priqueue_t *q, node_t *handle)
+{
+  if (q->backend == PRIQUEUE_HEAP) {
+    heap_update(q, handle);
+  }
+  else if (q->backend == PRIQUEUE_MINMAX) {
+    minmax_update(q, handle);
+  }
+  else if (q->backend == PRIQUEUE_TREE) {
+    tree_unlink(q, handle);
+    tree_link(q, handle);
+  }
+  else if (q->backend == PRIQUEUE_BUCKET) {
+    bucket_unlink(q, handle);
+    bucket_link(q, handle);
+  }
+  else if (q->backend == PRIQUEUE_PAIRING) {
+    pairing_unlink(q, handle);
+    pairing_link(q, handle);
+  }
+  else {
+    list_relink(q, handle);
+  }
+}
+
+
 /**
   Removes the specified index from the queue, moving later elements up
   a spot in the queue to fill the gap.
@@ -198,22 +760,9 @@ int priqueue_remove(priqueue_t *q, void *ptr)
  */
 void *priqueue_remove_at(priqueue_t *q, int index)
 {
-  if(index < 0 || q->top == NULL) return NULL;
-  else if (index == 0) {
-    node_t *remove = q->top;
-    q->top = q->top->next;
-    return destroy_node(remove);
-  }
-  else { // index > 0
-    node_t *prev = node_at(q->top, index - 1);
-    if(prev == NULL) return NULL;
-
-    node_t *remove = prev->next;
-    if(remove == NULL) return NULL;
-
-    prev->next = remove->next;
-    return destroy_node(remove);
-  }
+  void *item = remove_at(q, index);
+  if (item != NULL) PRIQUEUE_COUNT(q, removes, 1);
+  return item;
 }
 
 
@@ -225,7 +774,139 @@ void *priqueue_remove_at(priqueue_t *q, int index)
  */
 int priqueue_size(priqueue_t *q)
 {
-	return list_size(q->top);
+	return q->size;
+}
+
+
+/**
+  Returns the operation counters of the queue, accumulated since it was
+  initialized (priqueue_destroy does not reset them).
+
+  The counters are only maintained when the library is built with
+  -DPRIQUEUE_STATS (make STATS=1); otherwise every field reads zero.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @return the queue's counters, valid as long as q is
+ */
+const priqueue_stats_t *priqueue_get_stats(priqueue_t *q)
+{
+  return &q->stats;
+}
+
+
+/**
+  Pauses or resumes the operation counters, e.g. so that a debugging
+  traversal of the queue doesn't show up in them.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param paused nonzero to stop counting, zero to count again
+ */
+void priqueue_pause_stats(priqueue_t *q, int paused)
+{
+  q->stats_paused = paused;
+}
+
+
+/**
+  Pre-sizes the queue so that it can hold n elements without allocating.
+
+  Nodes released by poll/remove are recycled, so once a queue has been
+  reserved to its peak size, offer/poll/remove never call malloc or free.
+  Every backend grows its node pool to n nodes (for PRIQUEUE_HEAP and
+  PRIQUEUE_MINMAX these are the handles of priqueue_offer_handle), and the
+  heap backends also grow their slot array. PRIQUEUE_BUCKET may still grow
+  its bucket array when the span of queued keys widens.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param n the number of elements the queue should be able to hold
+ */
+void priqueue_reserve(priqueue_t *q, int n)
+{
+  if (q->backend == PRIQUEUE_HEAP || q->backend == PRIQUEUE_MINMAX) heap_reserve(q, n);
+  pool_reserve(&q->pool, n);
+}
+
+
+/**
+  Moves every element of src into dst, leaving src empty (but still usable).
+
+  When both are PRIQUEUE_PAIRING queues the two heaps are melded in O(1) and
+  src's nodes are handed over rather than copied (walking only src's slab list
+  and dst's free list), so handles into src stay valid and now refer to dst.
+  Equal-priority elements of the two queues are ordered by how many offers
+  each queue had seen, not strictly src after dst.
+  Otherwise src is drained in priority order and offered to dst as one batch
+  (see priqueue_offer_many), and handles into src are released.
+
+  Both queues must order elements the same way.
+
+  @param dst the queue receiving the elements
+  @param src the queue to empty
+ */
+void priqueue_merge(priqueue_t *dst, priqueue_t *src)
+{
+  if (dst->backend == PRIQUEUE_PAIRING && src->backend == PRIQUEUE_PAIRING) {
+    pairing_merge(dst, src);
+    return;
+  }
+
+  int n = priqueue_size(src);
+  void **items = malloc(sizeof(void *) * (n > 0 ? n : 1));
+  for (int i = 0; i < n; i++) items[i] = priqueue_poll(src);
+
+  priqueue_offer_many(dst, items, n);
+  free(items);
+}
+
+
+/**
+  Moves the lower-priority half of q (the last size / 2 elements in priority
+  order) into low, e.g. to donate work to another run queue.
+
+  The moved elements are offered to low as one batch in priority order, and
+  their handles into q are released. PRIQUEUE_HEAP and PRIQUEUE_MINMAX sort a
+  snapshot of their slots and rebuild q from its front half, O(n log n) in
+  all. The other backends walk q in order (see priqueue_iter_begin) and
+  unlink the back half as they reach it. Either way the moved half then costs
+  one priqueue_offer_many.
+
+  If memory runs out, both queues are left unchanged.
+
+  @param q the queue to split
+  @param low the queue receiving the lower-priority half
+ */
+void priqueue_split(priqueue_t *q, priqueue_t *low)
+{
+  int n = q->size / 2;
+  int keep = q->size - n;
+  void **items = malloc(sizeof(void *) * (n > 0 ? n : 1));
+  if (items == NULL) return;
+
+  if (q->backend == PRIQUEUE_HEAP || q->backend == PRIQUEUE_MINMAX) {
+    heap_entry_t *sorted = heap_sorted(q);
+    if (sorted == NULL) {
+      free(items);
+      return;
+    }
+
+    for (int i = 0; i < n; i++) items[i] = sorted[keep + i].item;
+    if (q->backend == PRIQUEUE_HEAP) heap_keep(q, sorted, keep);
+    else minmax_keep(q, sorted, keep);
+    free(sorted);
+    PRIQUEUE_COUNT(q, removes, n);
+  }
+  else {
+    priqueue_iter_t it;
+    int i = 0;
+    n = 0;
+
+    for (void *item = priqueue_iter_begin(q, &it); item != NULL; item = priqueue_iter_next(&it), i++) {
+      if (i >= keep) items[n++] = priqueue_iter_remove(&it);
+    }
+  }
+
+  priqueue_offer_many(low, items, n);
+  free(items);
 }
 
 
@@ -236,5 +917,168 @@ int priqueue_size(priqueue_t *q)
  */
 void priqueue_destroy(priqueue_t *q)
 {
-  destroy_list(q->top);
+  if (q->backend == PRIQUEUE_HEAP || q->backend == PRIQUEUE_MINMAX) heap_destroy(q);
+  if (q->backend == PRIQUEUE_BUCKET) bucket_destroy(q);
+
+  // list/tree/bucket/pairing nodes and handles all live in the pool's slabs
+  pool_destroy(&q->pool);
+  q->top = NULL;
+  q->tail = NULL;
+  q->root = NULL;
+  q->size = 0;
+}
+
+
+// whether iterators walk a sorted snapshot rather than following node links
+static inline int iter_snapshots(priqueue_t *q)
+{
+  return q->backend == PRIQUEUE_HEAP || q->backend == PRIQUEUE_MINMAX || q->backend == PRIQUEUE_PAIRING;
+}
+
+// moves the iterator onto node (or past the end when node is NULL)
+static void *iter_visit(priqueue_iter_t *it, node_t *node)
+{
+  it->node = node;
+  if (node == NULL) return NULL;
+
+  if (it->q->backend == PRIQUEUE_TREE) it->next = tree_next(node);
+  else if (it->q->backend == PRIQUEUE_BUCKET) it->next = bucket_next(it->q, node);
+  else it->next = node->next;
+  return node->item;
+}
+
+
+/**
+  Starts an in-order traversal of the queue.
+
+  Visiting every element costs O(n) in total for PRIQUEUE_LIST and
+  PRIQUEUE_TREE, and O(n + key span) for PRIQUEUE_BUCKET. PRIQUEUE_HEAP,
+  PRIQUEUE_MINMAX and PRIQUEUE_PAIRING are only partially ordered, so they walk
+  a sorted snapshot taken here, O(n log n).
+
+  The queue must not be modified during the traversal except through
+  priqueue_iter_remove.
+
+    priqueue_iter_t it;
+    for (job = priqueue_iter_begin(&q, &it); job != NULL; job = priqueue_iter_next(&it))
+      ...
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param it the iterator to initialize
+  @return the head of the queue
+  @return NULL if the queue is empty
+ */
+void *priqueue_iter_begin(priqueue_t *q, priqueue_iter_t *it)
+{
+  it->q = q;
+  it->node = NULL;
+  it->next = NULL;
+  it->order = NULL;
+  it->index = -1;
+  it->count = 0;
+
+  if (iter_snapshots(q)) {
+    it->order = q->backend == PRIQUEUE_PAIRING ? pairing_sorted(q) : heap_sorted(q);
+    it->count = q->size;
+    return priqueue_iter_next(it);
+  }
+
+  if (q->backend == PRIQUEUE_TREE) return iter_visit(it, tree_first(q));
+  if (q->backend == PRIQUEUE_BUCKET) return iter_visit(it, bucket_first(q));
+  return iter_visit(it, q->top);
+}
+
+
+/**
+  Advances the iterator to the next element in priority order.
+
+  @param it an iterator started with priqueue_iter_begin
+  @return the next element
+  @return NULL once every element has been visited
+ */
+void *priqueue_iter_next(priqueue_iter_t *it)
+{
+  if (iter_snapshots(it->q)) {
+    if (it->order == NULL) return NULL;
+    if (++it->index < it->count) return it->order[it->index].item;
+
+    priqueue_iter_end(it);
+    return NULL;
+  }
+
+  return iter_visit(it, it->next);
+}
+
+
+/**
+  Removes the element most recently returned by the iterator from the queue.
+
+  The traversal continues with that element's successor on the next call to
+  priqueue_iter_next. O(1) for PRIQUEUE_LIST/BUCKET and O(log n) for PRIQUEUE_TREE;
+  PRIQUEUE_HEAP/MINMAX search for the slot unless the element has a handle.
+  PRIQUEUE_PAIRING is O(log n) amortized.
+
+  @param it an iterator started with priqueue_iter_begin
+  @return the element removed from the queue
+  @return NULL if there is no current element
+ */
+void *priqueue_iter_remove(priqueue_iter_t *it)
+{
+  if (iter_snapshots(it->q)) {
+    if (it->order == NULL || it->index < 0 || it->order[it->index].item == NULL) return NULL;
+
+    heap_entry_t *entry = &it->order[it->index];
+    void *item;
+    if (it->q->backend == PRIQUEUE_PAIRING) item = release_node(it->q, entry->node);
+    else if (it->q->backend == PRIQUEUE_MINMAX) item = minmax_remove_entry(it->q, entry);
+    else item = heap_remove_entry(it->q, entry);
+    it->order[it->index].item = NULL;
+    PRIQUEUE_COUNT(it->q, removes, 1);
+    return item;
+  }
+
+  if (it->node == NULL) return NULL;
+
+  void *item = priqueue_remove_handle(it->q, it->node);
+  it->node = NULL;
+  return item;
+}
+
+
+/**
+  Finishes a traversal early, releasing anything the iterator holds.
+
+  Not needed once priqueue_iter_next has returned NULL, but always safe to call.
+
+  @param it an iterator started with priqueue_iter_begin
+ */
+void priqueue_iter_end(priqueue_iter_t *it)
+{
+  free(it->order);
+  it->order = NULL;
+  it->node = NULL;
+  it->next = NULL;
+}
+
+
+/**
+  Calls visit on each element in priority order until it returns non-zero.
+
+  @param q a pointer to an instance of the priqueue_t data structure
+  @param visit called as visit(item, arg); return non-zero to stop
+  @param arg passed through to visit
+  @return the element visit stopped at
+  @return NULL if visit never returned non-zero
+ */
+void *priqueue_foreach(priqueue_t *q, int(*visit)(void *item, void *arg), void *arg)
+{
+  priqueue_iter_t it;
+
+  for (void *item = priqueue_iter_begin(q, &it); item != NULL; item = priqueue_iter_next(&it)) {
+    if (visit(item, arg)) {
+      priqueue_iter_end(&it);
+      return item;
+    }
+  }
+  return NULL;
 }
@@ -4,24 +4,266 @@
 #ifndef LIBPRIQUEUE_H_
 #define LIBPRIQUEUE_H_
 
+#include <stddef.h>
+#include <pthread.h>
+
 /**
  * Node Data Structure (for representing nodes in the priority queue)
 */
 typedef struct _node_t
 {
   void *item; // pointer to the item referred to by this node
-  struct _node_t *next; // pointer to the next node (or NULL)
+  union {
+    struct { // PRIQUEUE_LIST/BUCKET (and the node pool's free list)
+      struct _node_t *next; // pointer to the next node (or NULL)
+      struct _node_t *prev; // pointer to the previous node (or NULL)
+      int key; // PRIQUEUE_BUCKET: key the node is filed under
+    };
+    int index; // PRIQUEUE_HEAP: current heap slot of this handle
+    struct { // PRIQUEUE_TREE
+      struct _node_t *left;
+      struct _node_t *right;
+      struct _node_t *parent;
+      int subtree_size; // nodes in the subtree rooted here
+      unsigned int weight; // random treap priority, smaller sits nearer the root
+    };
+    struct { // PRIQUEUE_PAIRING
+      struct _node_t *child; // first child (or NULL)
+      struct _node_t *sibling; // next sibling (or NULL)
+      struct _node_t *back; // previous sibling, or the parent for a first child (NULL for the root)
+      unsigned long seq; // insertion order, used to break comparer ties
+    };
+  };
 } node_t;
 
+/**
+ * Slab Data Structure (one contiguous block of nodes owned by a node pool)
+*/
+typedef struct _node_slab_t
+{
+  struct _node_slab_t *next; // previously allocated slab (or NULL)
+  int count; // number of nodes in this slab
+  node_t nodes[]; // the nodes themselves
+} node_slab_t;
+
+/**
+ * Node Pool Data Structure (recycles nodes so offer/poll don't hit malloc/free)
+*/
+typedef struct _node_pool_t
+{
+  node_t *free_list; // unused nodes, chained through their next pointers
+  node_t *free_tail; // last node of free_list, so pools merge in O(1)
+  node_slab_t *slabs; // every slab owned by the pool
+  int capacity; // total nodes across all slabs
+  int next_slab_size; // nodes to allocate when the free list runs dry
+} node_pool_t;
+
+/**
+ * Heap Entry Data Structure (for representing slots in the binary heap backend)
+*/
+typedef struct _heap_entry_t
+{
+  void *item; // pointer to the item stored in this slot
+  long long key; // sort key cached at offer time (keyed queues only, see priqueue_init_keyed)
+  unsigned long seq; // insertion order, used to break comparer ties
+  node_t *node; // handle tracking this slot (or NULL if none was requested)
+} heap_entry_t;
+
+/**
+ * Bucket Data Structure (one FIFO list of nodes sharing a key, see PRIQUEUE_BUCKET)
+*/
+typedef struct _bucket_t
+{
+  node_t *head;
+  node_t *tail;
+} bucket_t;
+
+/**
+  Storage layouts a priqueue_t can be backed by (chosen at init time)
+*/
+typedef enum {PRIQUEUE_LIST = 0, PRIQUEUE_HEAP, PRIQUEUE_TREE, PRIQUEUE_BUCKET, PRIQUEUE_MINMAX, PRIQUEUE_PAIRING} priqueue_backend_t;
+
+/**
+  Priqueue Operation Counters (see priqueue_get_stats)
+
+  Only counted when the library is built with -DPRIQUEUE_STATS (make STATS=1);
+  otherwise they stay zero and cost nothing.
+*/
+typedef struct _priqueue_stats_t
+{
+  unsigned long comparisons; // comparer calls, or cached key comparisons in keyed queues
+  unsigned long offers; // elements offered, including batches
+  unsigned long polls; // elements taken from either end by poll/poll_max
+  unsigned long removes; // elements taken by remove, remove_at, remove_handle and iter_remove
+  unsigned long nodes_walked; // nodes, buckets or heap levels stepped through while placing or finding elements
+  int max_size; // most elements queued at once
+} priqueue_stats_t;
+
+#ifdef PRIQUEUE_STATS
+#define PRIQUEUE_COUNT(q, counter, n) ((q)->stats_paused ? (void)0 : (void)((q)->stats.counter += (n)))
+#else
+#define PRIQUEUE_COUNT(q, counter, n) ((void)0)
+#endif
+
 /**
   Priqueue Data Structure
 */
 typedef struct _priqueue_t
 {
   int (*comparer)(const void *, const void *);
+  priqueue_backend_t backend;
+  unsigned long next_seq; // sequence number handed to the next offered item
+  int size; // number of elements currently in the queue
+  node_pool_t pool; // storage for every node and handle
+  priqueue_stats_t stats; // operation counters (only updated with PRIQUEUE_STATS)
+  int stats_paused; // nonzero while the counters are paused (see priqueue_pause_stats)
+
+  // PRIQUEUE_LIST
   node_t *top;
+  node_t *tail; // last node, so in-order offers append in O(1)
+
+  // PRIQUEUE_HEAP/MINMAX
+  heap_entry_t *heap; // array-backed binary (or min-max) heap, heap[0] is the head
+  int heap_capacity;
+  int keyed; // order slots by their cached key instead of calling comparer
+  long long (*sort_key)(const void *); // computes the key cached in keyed mode
+
+  // PRIQUEUE_TREE/PAIRING
+  node_t *root; // size-augmented treap (in-order traversal is priority order), or pairing heap
+  unsigned int tree_seed; // state of the generator for node weights
+
+  // PRIQUEUE_BUCKET
+  int (*key)(const void *); // small integer priority of an element, lower is higher priority
+  bucket_t *buckets; // circular, key k lives in buckets[k & (bucket_count - 1)]
+  int bucket_count; // power of two, always wider than the span of queued keys
+  int min_key; // no queued key is lower
+  int max_key; // no queued key is higher
 } priqueue_t;
 
+/**
+  Orders two heap slots (PRIQUEUE_HEAP/MINMAX) by their cached keys in keyed
+  queues or by the comparer otherwise, falling back to arrival order on ties.
+  Shared so both backends break ties the same way.
+*/
+static inline int entry_compare(priqueue_t *q, const heap_entry_t *a, const heap_entry_t *b)
+{
+  PRIQUEUE_COUNT(q, comparisons, 1);
+  if (q->keyed) {
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+  }
+  else {
+    int result = q->comparer(a->item, b->item);
+    if (result != 0) return result;
+  }
+  return a->seq < b->seq ? -1 : (a->seq > b->seq);
+}
+
+/**
+  Priqueue Iterator (walks a priqueue_t in priority order, see priqueue_iter_begin)
+*/
+typedef struct _priqueue_iter_t
+{
+  priqueue_t *q;
+  node_t *node; // PRIQUEUE_LIST/TREE/BUCKET: node holding the current element
+  node_t *next; // PRIQUEUE_LIST/TREE/BUCKET: its successor, saved so node can be removed
+  heap_entry_t *order; // PRIQUEUE_HEAP/MINMAX/PAIRING: snapshot of the heap in priority order
+  int index; // PRIQUEUE_HEAP/MINMAX/PAIRING: position of the current element in order
+  int count; // PRIQUEUE_HEAP/MINMAX/PAIRING: entries in order
+} priqueue_iter_t;
+
+/**
+ * Intrusive Queue Hook (embedded directly in the caller's struct)
+*/
+typedef struct _priqueue_hook_t
+{
+  struct _priqueue_hook_t *next; // next hook in priority order (or NULL)
+  struct _priqueue_hook_t *prev; // previous hook in priority order (or NULL)
+} priqueue_hook_t;
+
+/**
+  Intrusive Priqueue Data Structure
+
+  Links elements through a priqueue_hook_t embedded in each element, so offer
+  and remove never allocate and the comparer reads the element's own memory.
+  The queue does not own its elements.
+*/
+typedef struct _ipriqueue_t
+{
+  int (*comparer)(const priqueue_hook_t *, const priqueue_hook_t *);
+  priqueue_hook_t *top;
+  priqueue_hook_t *tail;
+  int size;
+} ipriqueue_t;
+
+/**
+ * Radix Heap Entry (one element and its key, stored inline in a bucket)
+*/
+typedef struct _radix_entry_t
+{
+  unsigned int key;
+  void *item;
+} radix_entry_t;
+
+/**
+ * Radix Heap Bucket (growable array of entries)
+*/
+typedef struct _radix_bucket_t
+{
+  radix_entry_t *entries;
+  int count;
+  int capacity;
+} radix_bucket_t;
+
+#define RADIX_BUCKETS 33 // bucket 0 holds keys equal to last, bucket i keys whose highest bit differing from last is bit i - 1
+
+/**
+  Radix Heap Data Structure
+
+  A monotone priority queue of unsigned integer keys: every key offered must
+  be at least the key most recently polled, as with event times in a
+  discrete-event simulation. Elements are never compared with each other,
+  and each one moves down through the buckets at most 32 times, so offer is
+  O(1) and poll amortized O(log U) for keys spanning a range of U.
+  Equal keys come out in arrival order.
+*/
+typedef struct _radix_heap_t
+{
+  radix_bucket_t buckets[RADIX_BUCKETS];
+  int head; // first entry of buckets[0] not yet polled
+  unsigned int last; // key most recently polled (0 before the first poll)
+  int size;
+} radix_heap_t;
+
+/**
+ * Concurrent Priority Queue Lane (one lock-guarded heap, padded to its own cache lines)
+*/
+typedef struct _cpriqueue_lane_t
+{
+  pthread_mutex_t lock;
+  priqueue_t queue;
+} __attribute__((aligned(64))) cpriqueue_lane_t;
+
+/**
+  Concurrent Priority Queue Data Structure
+
+  A relaxed MultiQueue: elements are spread over several lanes, each a
+  PRIQUEUE_HEAP behind its own mutex. Offer locks one random lane; poll locks
+  two random lanes and takes the better of their heads. Threads rarely
+  contend, but a poll only returns an element close to the head, not
+  necessarily the head itself, and equal elements are not kept in arrival
+  order. With two or more lanes per thread the expected rank of a polled
+  element stays O(lanes).
+*/
+typedef struct _cpriqueue_t
+{
+  cpriqueue_lane_t *lanes;
+  int lane_count;
+  int size; // updated atomically
+} cpriqueue_t;
+
+// gets a pointer to the struct of the given type containing the given hook
+#define PRIQUEUE_ENTRY(hook, type, member) ((type *)((char *)(hook) - offsetof(type, member)))
+
 /*
   For a given priqueue_t<T> (elements of type T)...
 
@@ -30,26 +272,138 @@ typedef struct _priqueue_t
     - comparer(l, r) < 0 <=> l is higher priority than r
     - comparer(l, r) > 0 <=> l is lower priority than r
     - comparer(l, r) == 0 <=> l is same priority as r
+
+  Elements of the same priority are kept in arrival (offer) order by every backend.
 */
 
+// node pool helper methods
+void pool_init (node_pool_t *pool);
+void pool_reserve (node_pool_t *pool, int capacity); // grows the pool to hold at least capacity nodes
+void pool_destroy (node_pool_t *pool); // frees every slab (and so every node) at once
+void pool_merge (node_pool_t *dst, node_pool_t *src); // moves every slab & free node of src into dst
+
 // node helper methods
-node_t *new_node (void *item, node_t *next); // mallocs & returns new node with fields filled
-void *destroy_node (node_t *node); // frees node & returns item pointer
-void destroy_list (node_t *node); // recursively frees node list
+node_t *new_node (node_pool_t *pool, void *item, node_t *next); // takes a node from the pool & fills its fields
+void *destroy_node (node_pool_t *pool, node_t *node); // returns node to the pool & returns item pointer
 node_t *node_at (node_t *node, int index); // gets the node at the given index in the node chain
-int list_size(node_t *node);
+int list_size(node_t *node); // counts the nodes in the chain (priqueue_t tracks its own size)
+
+// heap helper methods (see priqueue_heap.c)
+void   heap_reserve  (priqueue_t *q, int capacity); // grows the slot array to at least capacity
+long long heap_key    (priqueue_t *q, const void *item); // the key to cache for item (0 unless q is keyed)
+int    heap_offer    (priqueue_t *q, void *ptr, node_t *handle, long long key); // sifts ptr into place & returns its heap slot
+void   heap_offer_many(priqueue_t *q, void **items, int n); // appends items & sifts them up, or rebuilds in O(size)
+void * heap_at       (priqueue_t *q, int index); // index'th element in priority order
+int    heap_remove   (priqueue_t *q, void *ptr);
+void * heap_remove_at(priqueue_t *q, int index);
+void * heap_remove_handle(priqueue_t *q, node_t *handle);
+void   heap_update   (priqueue_t *q, node_t *handle); // re-sifts the handle's slot after a key change
+heap_entry_t *heap_sorted(priqueue_t *q); // mallocs a copy of the slots in priority order
+void   sort_entries  (priqueue_t *q, heap_entry_t *entries, int n); // stable sort by comparer, then seq
+void * heap_remove_entry(priqueue_t *q, const heap_entry_t *entry); // removes the slot a snapshot entry came from
+void   heap_keep     (priqueue_t *q, const heap_entry_t *sorted, int n); // refills the heap with the first n entries of a heap_sorted snapshot
+void * heap_peek_max (priqueue_t *q); // scans the leaves, O(n)
+void * heap_poll_max (priqueue_t *q);
+void   heap_destroy  (priqueue_t *q);
+
+// min-max heap helper methods (see priqueue_minmax.c; storage is shared with the heap helpers)
+int    minmax_offer    (priqueue_t *q, void *ptr, node_t *handle, long long key); // returns 0 iff ptr is the new head
+void   minmax_offer_many(priqueue_t *q, void **items, int n);
+void * minmax_at       (priqueue_t *q, int index); // O(1) at either end, O(n log n) in between
+int    minmax_remove   (priqueue_t *q, void *ptr);
+void * minmax_remove_at(priqueue_t *q, int index);
+void * minmax_remove_handle(priqueue_t *q, node_t *handle);
+void   minmax_update   (priqueue_t *q, node_t *handle);
+void * minmax_remove_entry(priqueue_t *q, const heap_entry_t *entry);
+void   minmax_keep     (priqueue_t *q, const heap_entry_t *sorted, int n); // heap_keep, then rebuilds the min-max order
+void * minmax_peek_max (priqueue_t *q);
+void * minmax_poll_max (priqueue_t *q);
+
+// tree helper methods (see priqueue_tree.c)
+int    tree_link     (priqueue_t *q, node_t *node); // inserts node after its equals & returns its index
+void   tree_link_sorted(priqueue_t *q, void **items, int n); // items must be in priority order; O(n) into an empty tree
+void   tree_unlink   (priqueue_t *q, node_t *node); // removes node from the tree (the node is not released)
+node_t *tree_at      (priqueue_t *q, int index); // gets the node with the given in-order index
+int    tree_remove   (priqueue_t *q, void *ptr);
+node_t *tree_first   (priqueue_t *q); // gets the node at the head of the queue
+node_t *tree_last    (priqueue_t *q); // gets the node at the tail of the queue
+node_t *tree_next    (node_t *node); // gets the in-order successor of node
+
+// bucket helper methods (see priqueue_bucket.c)
+int    bucket_link   (priqueue_t *q, node_t *node); // files node after its equals & returns 0 iff it is the new head
+void   bucket_unlink (priqueue_t *q, node_t *node); // removes node from its bucket (the node is not released)
+node_t *bucket_first (priqueue_t *q); // gets the node at the head of the queue
+node_t *bucket_last  (priqueue_t *q); // gets the node at the tail of the queue
+node_t *bucket_next  (priqueue_t *q, node_t *node); // gets the node after node in priority order
+node_t *bucket_at    (priqueue_t *q, int index);
+int    bucket_remove (priqueue_t *q, void *ptr);
+void   bucket_destroy(priqueue_t *q);
+
+// pairing heap helper methods (see priqueue_pairing.c)
+int    pairing_link  (priqueue_t *q, node_t *node); // melds node into the heap & returns 0 iff it is the new head
+void   pairing_unlink(priqueue_t *q, node_t *node); // removes node from the heap (the node is not released)
+heap_entry_t *pairing_sorted(priqueue_t *q); // mallocs the nodes, as entries, in priority order
+node_t *pairing_at   (priqueue_t *q, int index); // O(1) for the head, a sorted snapshot otherwise
+int    pairing_remove(priqueue_t *q, void *ptr);
+void   pairing_merge (priqueue_t *dst, priqueue_t *src); // melds the two roots & hands over src's nodes
 
 // priqueue methods
 void   priqueue_init     (priqueue_t *q, int(*comparer)(const void *, const void *));
+void   priqueue_init_backend(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend);
+void   priqueue_init_bucket(priqueue_t *q, int(*key)(const void *));
+void   priqueue_init_keyed(priqueue_t *q, long long(*sort_key)(const void *), priqueue_backend_t backend);
+void   priqueue_init_from_array(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend, void **items, int n);
 
 int    priqueue_offer    (priqueue_t *q, void *ptr);
+int    priqueue_offer_key(priqueue_t *q, void *ptr, long long key); // -1 unless q is a keyed heap or min-max queue
+node_t *priqueue_offer_handle(priqueue_t *q, void *ptr);
+void   priqueue_offer_many(priqueue_t *q, void **items, int n);
 void * priqueue_peek     (priqueue_t *q);
 void * priqueue_poll     (priqueue_t *q);
+void * priqueue_peek_max (priqueue_t *q);
+void * priqueue_poll_max (priqueue_t *q);
 void * priqueue_at       (priqueue_t *q, int index);
 int    priqueue_remove   (priqueue_t *q, void *ptr);
 void * priqueue_remove_at(priqueue_t *q, int index);
+void * priqueue_remove_handle(priqueue_t *q, node_t *handle);
+void   priqueue_update   (priqueue_t *q, node_t *handle);
 int    priqueue_size     (priqueue_t *q);
+const priqueue_stats_t *priqueue_get_stats(priqueue_t *q);
+void   priqueue_pause_stats(priqueue_t *q, int paused);
+void   priqueue_reserve  (priqueue_t *q, int n);
+void   priqueue_merge    (priqueue_t *dst, priqueue_t *src);
+void   priqueue_split    (priqueue_t *q, priqueue_t *low);
 
 void   priqueue_destroy  (priqueue_t *q);
 
+void * priqueue_iter_begin (priqueue_t *q, priqueue_iter_t *it);
+void * priqueue_iter_next  (priqueue_iter_t *it);
+void * priqueue_iter_remove(priqueue_iter_t *it);
+void   priqueue_iter_end   (priqueue_iter_t *it);
+void * priqueue_foreach    (priqueue_t *q, int(*visit)(void *item, void *arg), void *arg);
+
+// intrusive priqueue methods (see priqueue_intrusive.c)
+void              ipriqueue_init  (ipriqueue_t *q, int(*comparer)(const priqueue_hook_t *, const priqueue_hook_t *));
+int               ipriqueue_offer (ipriqueue_t *q, priqueue_hook_t *hook);
+priqueue_hook_t * ipriqueue_peek  (ipriqueue_t *q);
+priqueue_hook_t * ipriqueue_poll  (ipriqueue_t *q);
+void              ipriqueue_remove(ipriqueue_t *q, priqueue_hook_t *hook);
+int               ipriqueue_size  (ipriqueue_t *q);
+
+// radix heap methods (see priqueue_radix.c)
+void   radix_heap_init   (radix_heap_t *h);
+void   radix_heap_offer  (radix_heap_t *h, unsigned int key, void *item);
+void * radix_heap_peek   (radix_heap_t *h, unsigned int *key);
+void * radix_heap_poll   (radix_heap_t *h, unsigned int *key);
+int    radix_heap_size   (radix_heap_t *h);
+void   radix_heap_destroy(radix_heap_t *h);
+
+// concurrent priqueue methods (see priqueue_concurrent.c)
+void   cpriqueue_init   (cpriqueue_t *q, int(*comparer)(const void *, const void *), int lanes);
+void   cpriqueue_offer  (cpriqueue_t *q, void *ptr);
+void * cpriqueue_peek   (cpriqueue_t *q);
+void * cpriqueue_poll   (cpriqueue_t *q);
+int    cpriqueue_size   (cpriqueue_t *q);
+void   cpriqueue_destroy(cpriqueue_t *q);
+
 #endif /* LIBPQUEUE_H_ */
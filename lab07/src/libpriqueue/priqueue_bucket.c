@@ -0,0 +1,154 @@
+/** @file priqueue_bucket.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+#define BUCKET_MIN_COUNT 64
+
+/*
+  PRIQUEUE_BUCKET files every element under the small integer q->key returns
+  for it, one FIFO list per key, so equal keys keep arrival order. The bucket
+  array is circular (key k lives in buckets[k & (bucket_count - 1)]) and is
+  kept wider than the span of queued keys, so every bucket holds exactly one
+  key. The head is found by scanning up from min_key, which only moves forward
+  while keys are monotone (arrival times): offer and poll are then amortized
+  O(1). Non-monotone keys cost at most one scan of the key span (e.g. the
+  priority range).
+*/
+
+static inline bucket_t *bucket_of(priqueue_t *q, int key)
+{
+  return &q->buckets[key & (q->bucket_count - 1)];
+}
+
+// widens the bucket array until it spans min_key..max_key, keeping each bucket's order
+static void bucket_grow(priqueue_t *q)
+{
+  int count = q->bucket_count == 0 ? BUCKET_MIN_COUNT : q->bucket_count;
+  while (count <= q->max_key - q->min_key) count *= 2;
+  if (count == q->bucket_count) return;
+
+  bucket_t *old = q->buckets;
+  int old_count = q->bucket_count;
+
+  q->buckets = calloc(count, sizeof(bucket_t));
+  q->bucket_count = count;
+
+  // before growing, each old bucket held exactly one queued key
+  for (int i = 0; i < old_count; i++) {
+    if (old[i].head != NULL) *bucket_of(q, old[i].head->key) = old[i];
+  }
+  free(old);
+}
+
+
+int bucket_link(priqueue_t *q, node_t *node)
+{
+  int key = q->key(node->item);
+  node->key = key;
+
+  if (q->size == 0) {
+    q->min_key = key;
+    q->max_key = key;
+  }
+  else {
+    if (key < q->min_key) q->min_key = key;
+    if (key > q->max_key) q->max_key = key;
+  }
+  if (q->max_key - q->min_key >= q->bucket_count) bucket_grow(q);
+
+  // append after every element with the same key
+  bucket_t *bucket = bucket_of(q, key);
+  node->next = NULL;
+  node->prev = bucket->tail;
+  if (bucket->tail != NULL) bucket->tail->next = node;
+  else bucket->head = node;
+  bucket->tail = node;
+
+  q->size++;
+  return bucket_first(q) == node ? 0 : 1;
+}
+
+void bucket_unlink(priqueue_t *q, node_t *node)
+{
+  bucket_t *bucket = bucket_of(q, node->key);
+
+  if (node->prev != NULL) node->prev->next = node->next;
+  else bucket->head = node->next;
+  if (node->next != NULL) node->next->prev = node->prev;
+  else bucket->tail = node->prev;
+
+  q->size--;
+}
+
+node_t *bucket_first(priqueue_t *q)
+{
+  if (q->size == 0) return NULL;
+
+  // min_key is only a lower bound; catch it up to the lowest non-empty bucket
+  while (bucket_of(q, q->min_key)->head == NULL) {
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    q->min_key++;
+  }
+  return bucket_of(q, q->min_key)->head;
+}
+
+node_t *bucket_last(priqueue_t *q)
+{
+  if (q->size == 0) return NULL;
+
+  // max_key is only an upper bound; catch it down to the highest non-empty bucket
+  while (bucket_of(q, q->max_key)->tail == NULL) {
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    q->max_key--;
+  }
+  return bucket_of(q, q->max_key)->tail;
+}
+
+node_t *bucket_next(priqueue_t *q, node_t *node)
+{
+  if (node->next != NULL) return node->next;
+
+  for (int key = node->key + 1; key <= q->max_key; key++) {
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    if (bucket_of(q, key)->head != NULL) return bucket_of(q, key)->head;
+  }
+  return NULL;
+}
+
+node_t *bucket_at(priqueue_t *q, int index)
+{
+  if (index < 0 || index >= q->size) return NULL;
+
+  node_t *node = bucket_first(q);
+  while (index-- > 0) node = bucket_next(q, node);
+  return node;
+}
+
+int bucket_remove(priqueue_t *q, void *ptr)
+{
+  int removed = 0;
+  node_t *node = bucket_first(q);
+
+  while (node != NULL) {
+    node_t *next = bucket_next(q, node);
+
+    if (node->item == ptr) {
+      bucket_unlink(q, node);
+      destroy_node(&q->pool, node);
+      removed++;
+    }
+    node = next;
+  }
+
+  return removed;
+}
+
+void bucket_destroy(priqueue_t *q)
+{
+  free(q->buckets);
+  q->buckets = NULL;
+  q->bucket_count = 0;
+}
@@ -0,0 +1,163 @@
+/** @file priqueue_concurrent.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+// per-thread xorshift state for picking lanes (0 until the thread's first pick)
+static __thread unsigned int lane_seed;
+
+static unsigned int random_lane(cpriqueue_t *q)
+{
+  if (lane_seed == 0) lane_seed = (unsigned int)(size_t)&lane_seed | 1;
+
+  lane_seed ^= lane_seed << 13;
+  lane_seed ^= lane_seed >> 17;
+  lane_seed ^= lane_seed << 5;
+  return lane_seed % q->lane_count;
+}
+
+// locks a random lane, skipping lanes another thread holds, & returns it
+static cpriqueue_lane_t *lock_random_lane(cpriqueue_t *q)
+{
+  for (;;) {
+    cpriqueue_lane_t *lane = &q->lanes[random_lane(q)];
+    if (pthread_mutex_trylock(&lane->lock) == 0) return lane;
+  }
+}
+
+
+/**
+  Initializes a concurrent priority queue.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @param comparer a function pointer that compares two elements, as with priqueue_init
+  @param lanes the number of internal queues; two per thread using q works well
+ */
+void cpriqueue_init(cpriqueue_t *q, int(*comparer)(const void *, const void *), int lanes)
+{
+  if (lanes < 1) lanes = 1;
+
+  q->lanes = aligned_alloc(_Alignof(cpriqueue_lane_t), sizeof(cpriqueue_lane_t) * lanes);
+  q->lane_count = lanes;
+  q->size = 0;
+
+  for (int i = 0; i < lanes; i++) {
+    pthread_mutex_init(&q->lanes[i].lock, NULL);
+    priqueue_init_backend(&q->lanes[i].queue, comparer, PRIQUEUE_HEAP);
+  }
+}
+
+
+/**
+  Inserts the specified element into this queue. Safe to call from any thread.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @param ptr a pointer to the data to be inserted into the priority queue
+ */
+void cpriqueue_offer(cpriqueue_t *q, void *ptr)
+{
+  cpriqueue_lane_t *lane = lock_random_lane(q);
+  priqueue_offer(&lane->queue, ptr);
+  __atomic_add_fetch(&q->size, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&lane->lock);
+}
+
+
+/**
+  Retrieves, but does not remove, the head of this queue.
+
+  Every lane is locked while the heads are compared, so this is exact but
+  blocks all other threads; another thread may poll the element as soon as
+  this returns.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return pointer to element at the head of the queue
+  @return NULL if the queue is empty
+ */
+void *cpriqueue_peek(cpriqueue_t *q)
+{
+  void *best = NULL;
+
+  for (int i = 0; i < q->lane_count; i++) pthread_mutex_lock(&q->lanes[i].lock);
+
+  for (int i = 0; i < q->lane_count; i++) {
+    priqueue_t *queue = &q->lanes[i].queue;
+    void *head = priqueue_peek(queue);
+    if (head != NULL && (best == NULL || queue->comparer(head, best) < 0)) best = head;
+  }
+
+  for (int i = q->lane_count - 1; i >= 0; i--) pthread_mutex_unlock(&q->lanes[i].lock);
+  return best;
+}
+
+
+/**
+  Retrieves and removes an element at or near the head of this queue. Safe to
+  call from any thread.
+
+  Two random lanes are locked and the better of their heads is taken; if the
+  second lane is busy the first lane's head is taken on its own.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return an element from the front of the queue
+  @return NULL if the queue is empty
+ */
+void *cpriqueue_poll(cpriqueue_t *q)
+{
+  while (__atomic_load_n(&q->size, __ATOMIC_ACQUIRE) > 0) {
+    cpriqueue_lane_t *first = lock_random_lane(q);
+    cpriqueue_lane_t *second = &q->lanes[random_lane(q)];
+    if (second == first || pthread_mutex_trylock(&second->lock) != 0) second = NULL;
+
+    cpriqueue_lane_t *lane = first;
+    if (second != NULL) {
+      void *a = priqueue_peek(&first->queue);
+      void *b = priqueue_peek(&second->queue);
+      if (a == NULL || (b != NULL && first->queue.comparer(b, a) < 0)) lane = second;
+    }
+
+    // both lanes may be empty while others are not; pick again
+    void *item = priqueue_poll(&lane->queue);
+    if (item != NULL) __atomic_sub_fetch(&q->size, 1, __ATOMIC_RELEASE);
+
+    if (second != NULL) pthread_mutex_unlock(&second->lock);
+    pthread_mutex_unlock(&first->lock);
+    if (item != NULL) return item;
+  }
+
+  return NULL;
+}
+
+
+/**
+  Returns the number of elements in the queue.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+  @return the number of elements in the queue (a snapshot while other threads are running)
+ */
+int cpriqueue_size(cpriqueue_t *q)
+{
+  return __atomic_load_n(&q->size, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+  Destroys and frees all the memory associated with q. No other thread may
+  be using q.
+
+  @param q a pointer to an instance of the cpriqueue_t data structure
+ */
+void cpriqueue_destroy(cpriqueue_t *q)
+{
+  for (int i = 0; i < q->lane_count; i++) {
+    priqueue_destroy(&q->lanes[i].queue);
+    pthread_mutex_destroy(&q->lanes[i].lock);
+  }
+
+  free(q->lanes);
+  q->lanes = NULL;
+  q->lane_count = 0;
+  q->size = 0;
+}
@@ -0,0 +1,307 @@
+/** @file priqueue_heap.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+#define HEAP_MIN_CAPACITY 16
+
+#define HEAP_PARENT(i) (((i) - 1) / 2)
+#define HEAP_LEFT(i) (2 * (i) + 1)
+
+// stores entry in slot i, keeping its handle (if any) pointed at the slot
+static inline void place(priqueue_t *q, int i, heap_entry_t entry)
+{
+  q->heap[i] = entry;
+  if (entry.node != NULL) entry.node->index = i;
+}
+
+// moves slot i towards the root & returns the slot it settled in
+static int sift_up(priqueue_t *q, int i)
+{
+  heap_entry_t entry = q->heap[i];
+
+  while (i > 0) {
+    int parent = HEAP_PARENT(i);
+    if (entry_compare(q, &entry, &q->heap[parent]) >= 0) break;
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    place(q, i, q->heap[parent]);
+    i = parent;
+  }
+  place(q, i, entry);
+  return i;
+}
+
+static void sift_down(priqueue_t *q, int i)
+{
+  heap_entry_t entry = q->heap[i];
+
+  for (;;) {
+    int child = HEAP_LEFT(i);
+    if (child >= q->size) break;
+
+    // pick the higher priority child
+    if (child + 1 < q->size && entry_compare(q, &q->heap[child + 1], &q->heap[child]) < 0)
+      child++;
+    if (entry_compare(q, &q->heap[child], &entry) >= 0) break;
+
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    place(q, i, q->heap[child]);
+    i = child;
+  }
+  place(q, i, entry);
+}
+
+// restores the heap property over the whole array in O(n) (Floyd)
+static void heapify(priqueue_t *q)
+{
+  for (int i = q->size / 2 - 1; i >= 0; i--) sift_down(q, i);
+}
+
+// moves slot i whichever way restores the heap property
+static void resift(priqueue_t *q, int i)
+{
+  if (i > 0 && entry_compare(q, &q->heap[i], &q->heap[HEAP_PARENT(i)]) < 0)
+    sift_up(q, i);
+  else
+    sift_down(q, i);
+}
+
+// removes the given slot (releasing its handle), filling the gap with the last slot
+static void *delete_slot(priqueue_t *q, int slot)
+{
+  void *item = q->heap[slot].item;
+  if (q->heap[slot].node != NULL) destroy_node(&q->pool, q->heap[slot].node);
+
+  q->size--;
+  if (slot != q->size) {
+    place(q, slot, q->heap[q->size]);
+    resift(q, slot);
+  }
+  return item;
+}
+
+/*
+  Finds the slot holding the index'th element in priority order.
+
+  The heap is only partially ordered, so this does a best-first walk from the
+  root using a small auxiliary heap of candidate slots: O(index * log(index)).
+*/
+static int rank_to_slot(priqueue_t *q, int index)
+{
+  if (index < 0 || index >= q->size) return -1;
+  if (index == 0) return 0;
+
+  // every pop pushes at most two children, so the frontier never exceeds index + 2
+  int *frontier = malloc(sizeof(int) * (index + 2));
+  int count = 1;
+  int slot = -1;
+  frontier[0] = 0;
+
+  for (int rank = 0; rank <= index; rank++) {
+    // pop best candidate
+    slot = frontier[0];
+    int last = frontier[--count];
+    int i = 0;
+    for (;;) {
+      int child = HEAP_LEFT(i);
+      if (child >= count) break;
+      if (child + 1 < count && entry_compare(q, &q->heap[frontier[child + 1]], &q->heap[frontier[child]]) < 0)
+        child++;
+      if (entry_compare(q, &q->heap[frontier[child]], &q->heap[last]) >= 0) break;
+      frontier[i] = frontier[child];
+      i = child;
+    }
+    if (count > 0) frontier[i] = last;
+
+    // push its children
+    for (int c = HEAP_LEFT(slot); c <= HEAP_LEFT(slot) + 1 && c < q->size; c++) {
+      int j = count++;
+      while (j > 0 && entry_compare(q, &q->heap[c], &q->heap[frontier[HEAP_PARENT(j)]]) < 0) {
+        frontier[j] = frontier[HEAP_PARENT(j)];
+        j = HEAP_PARENT(j);
+      }
+      frontier[j] = c;
+    }
+  }
+
+  free(frontier);
+  return slot;
+}
+
+
+void heap_reserve(priqueue_t *q, int capacity)
+{
+  if (capacity <= q->heap_capacity) return;
+
+  q->heap_capacity = capacity;
+  q->heap = realloc(q->heap, sizeof(heap_entry_t) * q->heap_capacity);
+}
+
+long long heap_key(priqueue_t *q, const void *item)
+{
+  return q->keyed ? q->sort_key(item) : 0;
+}
+
+int heap_offer(priqueue_t *q, void *ptr, node_t *handle, long long key)
+{
+  if (q->size == q->heap_capacity)
+    heap_reserve(q, q->heap_capacity == 0 ? HEAP_MIN_CAPACITY : q->heap_capacity * 2);
+
+  int i = q->size++;
+  q->heap[i].item = ptr;
+  q->heap[i].key = key;
+  q->heap[i].seq = q->next_seq++;
+  q->heap[i].node = handle;
+  return sift_up(q, i);
+}
+
+void heap_offer_many(priqueue_t *q, void **items, int n)
+{
+  int queued = q->size;
+
+  heap_reserve(q, q->size + n);
+  for (int i = 0; i < n; i++) {
+    q->heap[q->size].item = items[i];
+    q->heap[q->size].key = heap_key(q, items[i]);
+    q->heap[q->size].seq = q->next_seq++;
+    q->heap[q->size].node = NULL;
+    q->size++;
+  }
+
+  // a rebuild is O(size): worth it once the batch outnumbers what was queued
+  if (n > queued) heapify(q);
+  else for (int i = queued; i < q->size; i++) sift_up(q, i);
+}
+
+void *heap_at(priqueue_t *q, int index)
+{
+  int slot = rank_to_slot(q, index);
+  return slot == -1 ? NULL : q->heap[slot].item;
+}
+
+int heap_remove(priqueue_t *q, void *ptr)
+{
+  // compact out every match, then rebuild the heap in O(n)
+  int kept = 0;
+  for (int i = 0; i < q->size; i++) {
+    if (q->heap[i].item != ptr) place(q, kept++, q->heap[i]);
+    else if (q->heap[i].node != NULL) destroy_node(&q->pool, q->heap[i].node);
+  }
+
+  int removed = q->size - kept;
+  q->size = kept;
+  if (removed > 0) heapify(q);
+  return removed;
+}
+
+void *heap_remove_at(priqueue_t *q, int index)
+{
+  int slot = rank_to_slot(q, index);
+  return slot == -1 ? NULL : delete_slot(q, slot);
+}
+
+void *heap_remove_handle(priqueue_t *q, node_t *handle)
+{
+  return delete_slot(q, handle->index);
+}
+
+void heap_update(priqueue_t *q, node_t *handle)
+{
+  int slot = handle->index;
+
+  // a fresh sequence number orders it after anything it now ties with
+  q->heap[slot].key = heap_key(q, q->heap[slot].item);
+  q->heap[slot].seq = q->next_seq++;
+  resift(q, slot);
+}
+
+void sort_entries(priqueue_t *q, heap_entry_t *entries, int n)
+{
+  heap_entry_t *sorted = entries;
+  heap_entry_t *scratch = malloc(sizeof(heap_entry_t) * (n > 0 ? n : 1));
+
+  // bottom-up merge sort
+  for (int width = 1; width < n; width *= 2) {
+    for (int lo = 0; lo < n; lo += 2 * width) {
+      int mid = lo + width < n ? lo + width : n;
+      int hi = lo + 2 * width < n ? lo + 2 * width : n;
+      int a = lo, b = mid, k = lo;
+      while (a < mid && b < hi)
+        scratch[k++] = entry_compare(q, &sorted[b], &sorted[a]) < 0 ? sorted[b++] : sorted[a++];
+      while (a < mid) scratch[k++] = sorted[a++];
+      while (b < hi) scratch[k++] = sorted[b++];
+    }
+    heap_entry_t *swap = sorted;
+    sorted = scratch;
+    scratch = swap;
+  }
+
+  // an odd number of passes leaves the result in the scratch buffer
+  if (sorted != entries) {
+    for (int i = 0; i < n; i++) entries[i] = sorted[i];
+    scratch = sorted;
+  }
+  free(scratch);
+}
+
+heap_entry_t *heap_sorted(priqueue_t *q)
+{
+  heap_entry_t *sorted = malloc(sizeof(heap_entry_t) * (q->size > 0 ? q->size : 1));
+  if (sorted == NULL) return NULL;
+
+  for (int i = 0; i < q->size; i++) sorted[i] = q->heap[i];
+  sort_entries(q, sorted, q->size);
+  return sorted;
+}
+
+void heap_keep(priqueue_t *q, const heap_entry_t *sorted, int n)
+{
+  for (int i = n; i < q->size; i++) {
+    if (sorted[i].node != NULL) destroy_node(&q->pool, sorted[i].node);
+  }
+
+  // an array in priority order already satisfies the heap property
+  for (int i = 0; i < n; i++) place(q, i, sorted[i]);
+  q->size = n;
+}
+
+void *heap_remove_entry(priqueue_t *q, const heap_entry_t *entry)
+{
+  if (entry->node != NULL) return delete_slot(q, entry->node->index);
+
+  // sequence numbers are unique, so they identify the slot
+  for (int i = 0; i < q->size; i++) {
+    if (q->heap[i].seq == entry->seq) return delete_slot(q, i);
+  }
+  return NULL;
+}
+
+// the tail of the queue is one of the leaves, which fill the back half of the array
+static int max_slot(priqueue_t *q)
+{
+  int slot = q->size - 1;
+  for (int i = q->size / 2; i < q->size - 1; i++) {
+    if (entry_compare(q, &q->heap[i], &q->heap[slot]) > 0) slot = i;
+  }
+  return slot;
+}
+
+void *heap_peek_max(priqueue_t *q)
+{
+  return q->size == 0 ? NULL : q->heap[max_slot(q)].item;
+}
+
+void *heap_poll_max(priqueue_t *q)
+{
+  return q->size == 0 ? NULL : delete_slot(q, max_slot(q));
+}
+
+void heap_destroy(priqueue_t *q)
+{
+  free(q->heap);
+  q->heap = NULL;
+  q->size = 0;
+  q->heap_capacity = 0;
+}
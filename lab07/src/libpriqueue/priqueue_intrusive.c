@@ -0,0 +1,119 @@
+/** @file priqueue_intrusive.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+
+/**
+  Initializes an intrusive priority queue.
+
+  Elements embed a priqueue_hook_t; comparer receives pointers to those hooks
+  and can recover the element with PRIQUEUE_ENTRY(hook, type, member).
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @param comparer compares two hooks, with the same sign convention as priqueue_init
+ */
+void ipriqueue_init(ipriqueue_t *q, int(*comparer)(const priqueue_hook_t *, const priqueue_hook_t *))
+{
+  q->comparer = comparer;
+  q->top = NULL;
+  q->tail = NULL;
+  q->size = 0;
+}
+
+
+/**
+  Links the element owning hook into the queue, after any elements of equal priority.
+
+  The hook must not already be linked into a queue.
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @param hook the hook embedded in the element to insert
+  @return the zero-based index where the element was placed
+ */
+int ipriqueue_offer(ipriqueue_t *q, priqueue_hook_t *hook)
+{
+  int i = 0;
+  priqueue_hook_t *target = NULL;
+
+  // fast path: the element sorts after the current tail (or the queue is empty)
+  if (q->tail == NULL || q->comparer(hook, q->tail) >= 0) {
+    i = q->size;
+  }
+  else {
+    target = q->top;
+    for (; q->comparer(hook, target) >= 0; ++i) target = target->next;
+  }
+
+  // link hook in front of target (or at the end when target is NULL)
+  hook->next = target;
+  hook->prev = target == NULL ? q->tail : target->prev;
+  if (hook->prev != NULL) hook->prev->next = hook;
+  else q->top = hook;
+  if (target != NULL) target->prev = hook;
+  else q->tail = hook;
+
+  q->size++;
+  return i;
+}
+
+
+/**
+  Retrieves, but does not unlink, the head of this queue.
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @return the hook at the head of the queue
+  @return NULL if the queue is empty
+ */
+priqueue_hook_t *ipriqueue_peek(ipriqueue_t *q)
+{
+  return q->top;
+}
+
+
+/**
+  Retrieves and unlinks the head of this queue.
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @return the hook at the head of the queue
+  @return NULL if the queue is empty
+ */
+priqueue_hook_t *ipriqueue_poll(ipriqueue_t *q)
+{
+  priqueue_hook_t *hook = q->top;
+  if (hook != NULL) ipriqueue_remove(q, hook);
+  return hook;
+}
+
+
+/**
+  Unlinks the element owning hook from the queue in O(1).
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @param hook a hook currently linked into q
+ */
+void ipriqueue_remove(ipriqueue_t *q, priqueue_hook_t *hook)
+{
+  if (hook->prev != NULL) hook->prev->next = hook->next;
+  else q->top = hook->next;
+  if (hook->next != NULL) hook->next->prev = hook->prev;
+  else q->tail = hook->prev;
+
+  hook->next = NULL;
+  hook->prev = NULL;
+  q->size--;
+}
+
+
+/**
+  Return the number of elements in the queue.
+
+  @param q a pointer to an instance of the ipriqueue_t data structure
+  @return the number of elements in the queue
+ */
+int ipriqueue_size(ipriqueue_t *q)
+{
+  return q->size;
+}
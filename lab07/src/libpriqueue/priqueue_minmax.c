@@ -0,0 +1,253 @@
+/** @file priqueue_minmax.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+#define MINMAX_MIN_CAPACITY 16
+
+#define MINMAX_PARENT(i) (((i) - 1) / 2)
+#define MINMAX_LEFT(i) (2 * (i) + 1)
+
+/*
+  PRIQUEUE_MINMAX is a min-max heap (Atkinson et al.): the binary heap array of
+  PRIQUEUE_HEAP, but levels alternate between min levels (even depth, at or
+  before everything below them) and max levels (odd depth, at or after
+  everything below them). The head sits in slot 0 and the tail in slot 1 or 2,
+  so both ends can be peeked in O(1) and polled in O(log n).
+*/
+
+// whether slot i belongs in front of slot j on a min level (or behind it on a max level)
+static inline int beats(priqueue_t *q, int i, int j, int max)
+{
+  int result = entry_compare(q, &q->heap[i], &q->heap[j]);
+  return max ? result > 0 : result < 0;
+}
+
+// depth 0 (the root) is a min level
+static inline int is_max_level(int i)
+{
+  int depth = 0;
+  for (i++; i > 1; i /= 2) depth++;
+  return depth % 2;
+}
+
+// swaps two slots, keeping their handles (if any) pointed at them
+static void swap(priqueue_t *q, int i, int j)
+{
+  heap_entry_t entry = q->heap[i];
+  q->heap[i] = q->heap[j];
+  q->heap[j] = entry;
+  if (q->heap[i].node != NULL) q->heap[i].node->index = i;
+  if (q->heap[j].node != NULL) q->heap[j].node->index = j;
+}
+
+// moves slot i up through the levels of its own kind & returns whether it moved
+static int push_up(priqueue_t *q, int i, int max)
+{
+  int moved = 0;
+  while (i >= 3 && beats(q, i, MINMAX_PARENT(MINMAX_PARENT(i)), max)) {
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    swap(q, i, MINMAX_PARENT(MINMAX_PARENT(i)));
+    i = MINMAX_PARENT(MINMAX_PARENT(i));
+    moved = 1;
+  }
+  return moved;
+}
+
+// moves slot i (on a level of the given kind) down until its subtree is in order
+static void push_down(priqueue_t *q, int i, int max)
+{
+  for (;;) {
+    int child = MINMAX_LEFT(i);
+    if (child >= q->size) return;
+
+    // best of the (up to two) children and (up to four) grandchildren
+    int best = child;
+    if (child + 1 < q->size && beats(q, child + 1, best, max)) best = child + 1;
+    for (int g = MINMAX_LEFT(child); g < MINMAX_LEFT(child) + 4 && g < q->size; g++) {
+      if (beats(q, g, best, max)) best = g;
+    }
+
+    if (!beats(q, best, i, max)) return;
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    swap(q, best, i);
+    if (best < MINMAX_LEFT(child)) return; // a child has no subtree of its own kind below
+
+    // a grandchild may now be out of order with its parent on the other kind of level
+    if (beats(q, MINMAX_PARENT(best), best, max)) swap(q, best, MINMAX_PARENT(best));
+    i = best;
+  }
+}
+
+// restores the heap over the whole array in O(n)
+static void heapify(priqueue_t *q)
+{
+  for (int i = q->size / 2 - 1; i >= 0; i--) push_down(q, i, is_max_level(i));
+}
+
+// restores the heap after slot k changed (or was filled from elsewhere)
+static void fix(priqueue_t *q, int k)
+{
+  int max = is_max_level(k);
+
+  // belongs on the other kind of level: trade places with the parent, which
+  // leaves each of the two slots needing repair in one direction only
+  if (k > 0 && beats(q, k, MINMAX_PARENT(k), !max)) {
+    int parent = MINMAX_PARENT(k);
+    swap(q, k, parent);
+    push_up(q, parent, !max);
+    push_down(q, k, max);
+  }
+  else if (!push_up(q, k, max)) {
+    push_down(q, k, max);
+  }
+}
+
+// removes the given slot (releasing its handle), filling the gap with the last slot
+static void *delete_slot(priqueue_t *q, int slot)
+{
+  void *item = q->heap[slot].item;
+  if (q->heap[slot].node != NULL) destroy_node(&q->pool, q->heap[slot].node);
+
+  q->size--;
+  if (slot != q->size) {
+    q->heap[slot] = q->heap[q->size];
+    if (q->heap[slot].node != NULL) q->heap[slot].node->index = slot;
+    fix(q, slot);
+  }
+  return item;
+}
+
+// slot holding the tail of the queue
+static int max_slot(priqueue_t *q)
+{
+  if (q->size <= 2) return q->size - 1;
+  return beats(q, 1, 2, 1) ? 1 : 2;
+}
+
+// slot holding the index'th element: O(1) at either end, otherwise a sorted snapshot
+static int rank_to_slot(priqueue_t *q, int index)
+{
+  if (index < 0 || index >= q->size) return -1;
+  if (index == 0) return 0;
+  if (index == q->size - 1) return max_slot(q);
+
+  heap_entry_t *sorted = heap_sorted(q);
+  int slot = sorted[index].node != NULL ? sorted[index].node->index : -1;
+
+  // sequence numbers are unique, so they identify the slot
+  for (int i = 0; slot == -1; i++) {
+    if (q->heap[i].seq == sorted[index].seq) slot = i;
+  }
+  free(sorted);
+  return slot;
+}
+
+
+int minmax_offer(priqueue_t *q, void *ptr, node_t *handle, long long key)
+{
+  if (q->size == q->heap_capacity)
+    heap_reserve(q, q->heap_capacity == 0 ? MINMAX_MIN_CAPACITY : q->heap_capacity * 2);
+
+  int i = q->size++;
+  q->heap[i].item = ptr;
+  q->heap[i].key = key;
+  q->heap[i].seq = q->next_seq++;
+  q->heap[i].node = handle;
+  if (handle != NULL) handle->index = i;
+  fix(q, i);
+
+  // slot 0 always holds the head
+  return q->heap[0].seq == q->next_seq - 1 ? 0 : 1;
+}
+
+void minmax_offer_many(priqueue_t *q, void **items, int n)
+{
+  int queued = q->size;
+
+  heap_reserve(q, q->size + n);
+  for (int i = 0; i < n; i++) {
+    q->heap[q->size].item = items[i];
+    q->heap[q->size].key = heap_key(q, items[i]);
+    q->heap[q->size].seq = q->next_seq++;
+    q->heap[q->size].node = NULL;
+    q->size++;
+  }
+
+  // a rebuild is O(size): worth it once the batch outnumbers what was queued
+  if (n > queued) heapify(q);
+  else for (int i = queued; i < q->size; i++) fix(q, i);
+}
+
+void *minmax_at(priqueue_t *q, int index)
+{
+  int slot = rank_to_slot(q, index);
+  return slot == -1 ? NULL : q->heap[slot].item;
+}
+
+int minmax_remove(priqueue_t *q, void *ptr)
+{
+  // compact out every match, then rebuild the heap in O(n)
+  int kept = 0;
+  for (int i = 0; i < q->size; i++) {
+    if (q->heap[i].item == ptr) {
+      if (q->heap[i].node != NULL) destroy_node(&q->pool, q->heap[i].node);
+      continue;
+    }
+    q->heap[kept] = q->heap[i];
+    if (q->heap[kept].node != NULL) q->heap[kept].node->index = kept;
+    kept++;
+  }
+
+  int removed = q->size - kept;
+  q->size = kept;
+  if (removed > 0) heapify(q);
+  return removed;
+}
+
+void *minmax_remove_at(priqueue_t *q, int index)
+{
+  int slot = rank_to_slot(q, index);
+  return slot == -1 ? NULL : delete_slot(q, slot);
+}
+
+void *minmax_remove_handle(priqueue_t *q, node_t *handle)
+{
+  return delete_slot(q, handle->index);
+}
+
+void minmax_update(priqueue_t *q, node_t *handle)
+{
+  // a fresh sequence number orders it after anything it now ties with
+  q->heap[handle->index].key = heap_key(q, q->heap[handle->index].item);
+  q->heap[handle->index].seq = q->next_seq++;
+  fix(q, handle->index);
+}
+
+void minmax_keep(priqueue_t *q, const heap_entry_t *sorted, int n)
+{
+  heap_keep(q, sorted, n);
+  heapify(q);
+}
+
+void *minmax_remove_entry(priqueue_t *q, const heap_entry_t *entry)
+{
+  if (entry->node != NULL) return delete_slot(q, entry->node->index);
+
+  for (int i = 0; i < q->size; i++) {
+    if (q->heap[i].seq == entry->seq) return delete_slot(q, i);
+  }
+  return NULL;
+}
+
+void *minmax_peek_max(priqueue_t *q)
+{
+  return q->size == 0 ? NULL : q->heap[max_slot(q)].item;
+}
+
+void *minmax_poll_max(priqueue_t *q)
+{
+  return q->size == 0 ? NULL : delete_slot(q, max_slot(q));
+}
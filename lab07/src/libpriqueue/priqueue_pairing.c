@@ -0,0 +1,185 @@
+/** @file priqueue_pairing.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+/*
+  PRIQUEUE_PAIRING is a pairing heap: a tree in which every node is at or
+  before its children, stored as first-child/next-sibling links. Offer and
+  meld are O(1): the root that sorts later becomes the first child of the
+  other. Poll removes the root and pairs its children up left to right, then
+  melds the pairs right to left, O(log n) amortized. Because melding two
+  heaps is a single comparison, priqueue_merge of two pairing queues is O(1).
+*/
+
+// whether a belongs in front of b, falling back to arrival order on ties
+static inline int before(priqueue_t *q, node_t *a, node_t *b)
+{
+  PRIQUEUE_COUNT(q, comparisons, 1);
+  int result = q->comparer(a->item, b->item);
+  return result != 0 ? result < 0 : a->seq < b->seq;
+}
+
+// melds two detached heaps (either may be NULL) & returns the new root
+static node_t *meld(priqueue_t *q, node_t *a, node_t *b)
+{
+  if (a == NULL) return b;
+  if (b == NULL) return a;
+
+  if (before(q, b, a)) {
+    node_t *swap = a;
+    a = b;
+    b = swap;
+  }
+
+  // b becomes a's first child
+  b->sibling = a->child;
+  if (a->child != NULL) a->child->back = b;
+  b->back = a;
+  a->child = b;
+  return a;
+}
+
+// melds a list of siblings into one detached heap (two-pass pairing)
+static node_t *combine(priqueue_t *q, node_t *first)
+{
+  node_t *pairs = NULL;
+
+  // left to right: meld neighbours in pairs, stacking the results
+  while (first != NULL) {
+    node_t *a = first;
+    node_t *b = a->sibling;
+    first = b == NULL ? NULL : b->sibling;
+
+    a->sibling = NULL;
+    a->back = NULL;
+    if (b != NULL) {
+      b->sibling = NULL;
+      b->back = NULL;
+    }
+
+    node_t *pair = meld(q, a, b);
+    pair->sibling = pairs;
+    pairs = pair;
+  }
+
+  // right to left: fold the stack into a single heap
+  node_t *root = NULL;
+  while (pairs != NULL) {
+    node_t *next = pairs->sibling;
+    pairs->sibling = NULL;
+    root = meld(q, root, pairs);
+    pairs = next;
+  }
+  return root;
+}
+
+// mallocs an entry for every node, in heap (not priority) order
+static heap_entry_t *collect(priqueue_t *q)
+{
+  heap_entry_t *entries = malloc(sizeof(heap_entry_t) * (q->size > 0 ? q->size : 1));
+  int count = 0;
+
+  // preorder walk: down through first children, across through siblings,
+  // and back up through the back links once a subtree is done
+  node_t *node = q->root;
+  while (node != NULL) {
+    entries[count].item = node->item;
+    entries[count].seq = node->seq;
+    entries[count].node = node;
+    count++;
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+
+    if (node->child != NULL) {
+      node = node->child;
+      continue;
+    }
+    while (node != NULL && node->sibling == NULL) {
+      // climb to the parent: back through earlier siblings to the first child
+      while (node->back != NULL && node->back->child != node) node = node->back;
+      node = node->back;
+    }
+    if (node != NULL) node = node->sibling;
+  }
+
+  return entries;
+}
+
+
+int pairing_link(priqueue_t *q, node_t *node)
+{
+  node->child = NULL;
+  node->sibling = NULL;
+  node->back = NULL;
+  node->seq = q->next_seq++;
+
+  q->root = meld(q, q->root, node);
+  q->size++;
+  return q->root == node ? 0 : 1;
+}
+
+void pairing_unlink(priqueue_t *q, node_t *node)
+{
+  if (node == q->root) {
+    q->root = combine(q, node->child);
+  }
+  else {
+    // cut node (and its subtree) out of its sibling list
+    if (node->back->child == node) node->back->child = node->sibling;
+    else node->back->sibling = node->sibling;
+    if (node->sibling != NULL) node->sibling->back = node->back;
+
+    q->root = meld(q, q->root, combine(q, node->child));
+  }
+
+  q->size--;
+}
+
+heap_entry_t *pairing_sorted(priqueue_t *q)
+{
+  heap_entry_t *sorted = collect(q);
+  sort_entries(q, sorted, q->size);
+  return sorted;
+}
+
+node_t *pairing_at(priqueue_t *q, int index)
+{
+  if (index < 0 || index >= q->size) return NULL;
+  if (index == 0) return q->root;
+
+  heap_entry_t *sorted = pairing_sorted(q);
+  node_t *node = sorted[index].node;
+  free(sorted);
+  return node;
+}
+
+int pairing_remove(priqueue_t *q, void *ptr)
+{
+  heap_entry_t *entries = collect(q);
+  int count = q->size;
+  int removed = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (entries[i].item == ptr) {
+      pairing_unlink(q, entries[i].node);
+      destroy_node(&q->pool, entries[i].node);
+      removed++;
+    }
+  }
+
+  free(entries);
+  return removed;
+}
+
+void pairing_merge(priqueue_t *dst, priqueue_t *src)
+{
+  dst->root = meld(dst, dst->root, src->root);
+  dst->size += src->size;
+  if (src->next_seq > dst->next_seq) dst->next_seq = src->next_seq;
+  pool_merge(&dst->pool, &src->pool);
+
+  src->root = NULL;
+  src->size = 0;
+}
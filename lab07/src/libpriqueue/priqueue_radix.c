@@ -0,0 +1,172 @@
+/** @file priqueue_radix.c
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libpriqueue.h"
+
+#define RADIX_MIN_CAPACITY 16
+
+// bucket a key belongs in, relative to the last polled key
+static inline int bucket_index(radix_heap_t *h, unsigned int key)
+{
+  return key == h->last ? 0 : 32 - __builtin_clz(key ^ h->last);
+}
+
+static void append(radix_bucket_t *bucket, unsigned int key, void *item)
+{
+  if (bucket->count == bucket->capacity) {
+    bucket->capacity = bucket->capacity == 0 ? RADIX_MIN_CAPACITY : bucket->capacity * 2;
+    bucket->entries = realloc(bucket->entries, sizeof(radix_entry_t) * bucket->capacity);
+  }
+  bucket->entries[bucket->count].key = key;
+  bucket->entries[bucket->count].item = item;
+  bucket->count++;
+}
+
+/*
+  Makes sure bucket 0 holds the next element: once it runs dry, the lowest
+  non-empty bucket's smallest key becomes last, and that bucket's entries are
+  redistributed relative to it, all into lower buckets and the smallest into
+  bucket 0. Entries are moved in order and equal keys always share a bucket,
+  so equal keys stay in arrival order.
+*/
+static void settle(radix_heap_t *h)
+{
+  radix_bucket_t *zero = &h->buckets[0];
+  if (h->head < zero->count) return;
+
+  zero->count = 0;
+  h->head = 0;
+
+  int i = 1;
+  while (h->buckets[i].count == 0) i++;
+
+  radix_bucket_t *bucket = &h->buckets[i];
+  unsigned int min = bucket->entries[0].key;
+  for (int j = 1; j < bucket->count; j++) {
+    if (bucket->entries[j].key < min) min = bucket->entries[j].key;
+  }
+
+  h->last = min;
+  for (int j = 0; j < bucket->count; j++) {
+    radix_entry_t *entry = &bucket->entries[j];
+    append(&h->buckets[bucket_index(h, entry->key)], entry->key, entry->item);
+  }
+  bucket->count = 0;
+}
+
+/*
+  Drops the polled prefix of bucket 0 once it fills half the buffer. Offers
+  at the current minimum land in bucket 0 without settle ever running, so
+  otherwise interleaved offers and polls would grow it without bound. Each
+  compaction moves at most half the buffer and follows at least as many
+  polls, so it is amortized O(1).
+*/
+static void compact_zero(radix_heap_t *h)
+{
+  radix_bucket_t *zero = &h->buckets[0];
+  if (h->head * 2 <= zero->capacity) return;
+
+  zero->count -= h->head;
+  memmove(zero->entries, zero->entries + h->head, sizeof(radix_entry_t) * zero->count);
+  h->head = 0;
+}
+
+
+/**
+  Initializes a radix heap.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+ */
+void radix_heap_init(radix_heap_t *h)
+{
+  for (int i = 0; i < RADIX_BUCKETS; i++) {
+    h->buckets[i].entries = NULL;
+    h->buckets[i].count = 0;
+    h->buckets[i].capacity = 0;
+  }
+  h->head = 0;
+  h->last = 0;
+  h->size = 0;
+}
+
+
+/**
+  Inserts item with the given key, after any queued elements with the same key.
+
+  key must not be lower than the key of the element most recently polled.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+  @param key the element's priority (lower is higher priority)
+  @param item the element to insert
+ */
+void radix_heap_offer(radix_heap_t *h, unsigned int key, void *item)
+{
+  append(&h->buckets[bucket_index(h, key)], key, item);
+  h->size++;
+}
+
+
+/**
+  Retrieves, but does not remove, the element with the lowest key.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+  @param key if not NULL, receives the element's key
+  @return the element at the head of the heap
+  @return NULL if the heap is empty
+ */
+void *radix_heap_peek(radix_heap_t *h, unsigned int *key)
+{
+  if (h->size == 0) return NULL;
+
+  settle(h);
+  radix_entry_t *entry = &h->buckets[0].entries[h->head];
+  if (key != NULL) *key = entry->key;
+  return entry->item;
+}
+
+
+/**
+  Retrieves and removes the element with the lowest key.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+  @param key if not NULL, receives the element's key
+  @return the element at the head of the heap
+  @return NULL if the heap is empty
+ */
+void *radix_heap_poll(radix_heap_t *h, unsigned int *key)
+{
+  void *item = radix_heap_peek(h, key);
+  if (item == NULL) return NULL;
+
+  h->head++;
+  h->size--;
+  compact_zero(h);
+  return item;
+}
+
+
+/**
+  Returns the number of elements in the heap.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+  @return the number of elements in the heap
+ */
+int radix_heap_size(radix_heap_t *h)
+{
+  return h->size;
+}
+
+
+/**
+  Frees all the memory associated with h.
+
+  @param h a pointer to an instance of the radix_heap_t data structure
+ */
+void radix_heap_destroy(radix_heap_t *h)
+{
+  for (int i = 0; i < RADIX_BUCKETS; i++) free(h->buckets[i].entries);
+  radix_heap_init(h);
+}
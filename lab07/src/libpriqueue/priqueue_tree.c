@@ -0,0 +1,248 @@
+/** @file priqueue_tree.c
+ */
+
+#include <stdlib.h>
+
+#include "libpriqueue.h"
+
+/*
+  PRIQUEUE_TREE is a treap: a binary search tree in priority order (equal
+  elements go right, so in-order traversal keeps arrival order) that is also
+  a min-heap on each node's random weight, which keeps the expected depth at
+  O(log n). Every node also counts the nodes in its subtree, so ranks and
+  indexed lookups are O(log n) as well.
+*/
+
+static inline int subtree_size(node_t *node)
+{
+  return node == NULL ? 0 : node->subtree_size;
+}
+
+// xorshift32; deterministic so runs are reproducible
+static unsigned int next_weight(priqueue_t *q)
+{
+  unsigned int x = q->tree_seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  q->tree_seed = x;
+  return x;
+}
+
+// points whatever referred to old (its parent, or the root) at new
+static void replace_child(priqueue_t *q, node_t *parent, node_t *old, node_t *new)
+{
+  if (parent == NULL) q->root = new;
+  else if (parent->left == old) parent->left = new;
+  else parent->right = new;
+}
+
+// rotates node above its parent, preserving in-order order and subtree sizes
+static void rotate_up(priqueue_t *q, node_t *node)
+{
+  node_t *parent = node->parent;
+
+  if (parent->left == node) {
+    parent->left = node->right;
+    if (node->right != NULL) node->right->parent = parent;
+    node->right = parent;
+  }
+  else {
+    parent->right = node->left;
+    if (node->left != NULL) node->left->parent = parent;
+    node->left = parent;
+  }
+
+  replace_child(q, parent->parent, parent, node);
+  node->parent = parent->parent;
+  parent->parent = node;
+
+  node->subtree_size = parent->subtree_size;
+  parent->subtree_size = 1 + subtree_size(parent->left) + subtree_size(parent->right);
+}
+
+
+// recomputes every subtree size in the tree under root, in post-order,
+// following parent links rather than recursing so depth costs no stack
+static void count_subtree(node_t *root)
+{
+  node_t *prev = NULL;
+  node_t *node = root;
+
+  while (node != NULL) {
+    node_t *next = NULL;
+    if (prev == node->parent) next = node->left != NULL ? node->left : node->right;
+    else if (prev == node->left) next = node->right;
+
+    if (next != NULL) {
+      prev = node;
+      node = next;
+      continue;
+    }
+
+    // both children are counted
+    node->subtree_size = 1 + subtree_size(node->left) + subtree_size(node->right);
+    prev = node;
+    node = node == root ? NULL : node->parent;
+  }
+}
+
+
+int tree_link(priqueue_t *q, node_t *node)
+{
+  node_t *parent = NULL;
+  node_t *target = q->root;
+  int index = 0;
+  int left = 0;
+
+  node->left = NULL;
+  node->right = NULL;
+  node->subtree_size = 1;
+  node->weight = next_weight(q);
+
+  // descend to a leaf position, counting everything that sorts before node
+  while (target != NULL) {
+    parent = target;
+    target->subtree_size++;
+    PRIQUEUE_COUNT(q, comparisons, 1);
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    left = q->comparer(node->item, target->item) < 0;
+    if (left) {
+      target = target->left;
+    }
+    else {
+      index += subtree_size(target->left) + 1;
+      target = target->right;
+    }
+  }
+
+  node->parent = parent;
+  if (parent == NULL) q->root = node;
+  else if (left) parent->left = node;
+  else parent->right = node;
+
+  // restore the heap order on weights
+  while (node->parent != NULL && node->weight < node->parent->weight) rotate_up(q, node);
+
+  q->size++;
+  return index;
+}
+
+void tree_link_sorted(priqueue_t *q, void **items, int n)
+{
+  if (q->root != NULL) {
+    for (int i = 0; i < n; i++) tree_link(q, new_node(&q->pool, items[i], NULL));
+    return;
+  }
+
+  // into an empty tree, build the treap directly in O(n): append each node to
+  // the right spine, lifting it above every spine node that outweighs it
+  node_t **spine = malloc(sizeof(node_t *) * n);
+  int depth = 0;
+
+  for (int i = 0; i < n; i++) {
+    node_t *node = new_node(&q->pool, items[i], NULL);
+    node_t *lifted = NULL;
+
+    node->weight = next_weight(q);
+    while (depth > 0 && spine[depth - 1]->weight > node->weight) lifted = spine[--depth];
+
+    node->left = lifted;
+    node->right = NULL;
+    if (lifted != NULL) lifted->parent = node;
+    node->parent = depth > 0 ? spine[depth - 1] : NULL;
+    if (node->parent != NULL) node->parent->right = node;
+    spine[depth++] = node;
+  }
+
+  q->root = spine[0];
+  free(spine);
+  count_subtree(q->root);
+  q->size = n;
+}
+
+void tree_unlink(priqueue_t *q, node_t *node)
+{
+  // rotate node down until it is a leaf, always lifting the lighter child
+  while (node->left != NULL || node->right != NULL) {
+    node_t *child;
+    if (node->left == NULL) child = node->right;
+    else if (node->right == NULL) child = node->left;
+    else child = node->left->weight < node->right->weight ? node->left : node->right;
+    rotate_up(q, child);
+  }
+
+  replace_child(q, node->parent, node, NULL);
+  for (node_t *ancestor = node->parent; ancestor != NULL; ancestor = ancestor->parent)
+    ancestor->subtree_size--;
+
+  q->size--;
+}
+
+node_t *tree_at(priqueue_t *q, int index)
+{
+  if (index < 0 || index >= q->size) return NULL;
+
+  node_t *node = q->root;
+  for (;;) {
+    int left = subtree_size(node->left);
+    PRIQUEUE_COUNT(q, nodes_walked, 1);
+    if (index < left) {
+      node = node->left;
+    }
+    else if (index == left) {
+      return node;
+    }
+    else {
+      index -= left + 1;
+      node = node->right;
+    }
+  }
+}
+
+node_t *tree_first(priqueue_t *q)
+{
+  node_t *node = q->root;
+  while (node != NULL && node->left != NULL) node = node->left;
+  return node;
+}
+
+node_t *tree_last(priqueue_t *q)
+{
+  node_t *node = q->root;
+  while (node != NULL && node->right != NULL) node = node->right;
+  return node;
+}
+
+node_t *tree_next(node_t *node)
+{
+  if (node->right != NULL) {
+    node = node->right;
+    while (node->left != NULL) node = node->left;
+    return node;
+  }
+
+  while (node->parent != NULL && node->parent->right == node) node = node->parent;
+  return node->parent;
+}
+
+int tree_remove(priqueue_t *q, void *ptr)
+{
+  int removed = 0;
+  node_t *node = tree_first(q);
+
+  // iterative in-order walk, unlinking matches as they are found; rotations
+  // keep in-order order, so the successor found beforehand stays correct
+  while (node != NULL) {
+    node_t *next = tree_next(node);
+
+    if (node->item == ptr) {
+      tree_unlink(q, node);
+      destroy_node(&q->pool, node);
+      removed++;
+    }
+    node = next;
+  }
+
+  return removed;
+}
@@ -7,6 +7,13 @@
 
 #include "libscheduler.h"
 #include "../libpriqueue/libpriqueue.h"
+#include "../libpriqueue/typed_priqueue.h"
+
+#define CORE_WORD_BITS (8 * (int)sizeof(unsigned long)) // cores per idle_cores word
+#define RING_MIN_CAPACITY 16
+
+// MLFQ's quantum on each level until scheduler_set_mlfq() says otherwise
+static const int mlfq_default_quanta[] = {2, 4, 8};
  
 /**
   Stores information making up a job to be scheduled including any statistics.
@@ -18,148 +25,491 @@ typedef struct _job_t
 	int job_id;
 	int priority; // lower value is higher priority
 
-	int arrival_time;
+	int arrival_time; // when the job arrived; never changes, so the stats stay right
 	int run_time; // total execution time needed
 	int remaining_time;
 	int first_run_time; // time when job first started running (-1 if not run yet)
 	int completion_time;
-	int current_core;
+	int current_core; // -1 while waiting in ready_queue
+	int last_run_time; // time remaining_time was last brought up to date while running
+	int slice_start; // time the job was last put on a core
+	int level; // MLFQ level, 0 being the top (0 under every other scheme)
+
+	node_t* running_node; // handle to this job's entry in running_jobs (while running)
 } job_t;
 
-// global variables for scheduler info
-scheme_t scheduler_scheme;
-int scheduler_cores;
-priqueue_t job_queue;
-int* core_job_map; // keep track of which core is running what
+/**
+  A circular FIFO of jobs, for schemes that take turns rather than sort.
+*/
+typedef struct _job_ring_t
+{
+	job_t** jobs;
+	int head; // index of the front job
+	int count;
+	int capacity; // a power of two (or 0 before the first push)
+} job_ring_t;
+
+/**
+  How a scheduling scheme orders, picks and preempts jobs. Each scheme_t has
+  one of these in policies[]; a NULL hook falls back to the default noted
+  beside it.
+*/
+typedef struct _scheduler_policy_ops
+{
+	int (*compare)(const void*, const void*); // the scheme's order of jobs, waiting or running
+	long long (*sort_key)(const void*); // the same order as a key (running_jobs caches it)
+	void (*init)(scheduler_t* s); // set up the ready queue
+	void (*destroy)(scheduler_t* s); // free the ready queue, once it is empty
+	void (*enqueue)(scheduler_t* s, job_t* job); // job starts (or goes back to) waiting
+	job_t* (*pick_next)(scheduler_t* s); // remove & return the next job to run, or NULL
+	int (*should_preempt)(job_t* new_job, job_t* running_job); // NULL: never preempts
+	void (*on_tick)(scheduler_t* s, int time); // NULL: nothing; time has moved on to a new arrival
+	void (*on_quantum)(scheduler_t* s, job_t* job, int time); // NULL: job keeps its core
+	void (*show)(scheduler_t* s); // NULL: running & ready jobs merged in compare order
+	int uses_ready_queue; // 0: jobs wait in ready_rings, and ready_queue is never set up
+} scheduler_policy_ops;
+
+/**
+  Scheduler state: one simulation's jobs, cores and running statistics.
+*/
+struct _scheduler_t
+{
+	scheme_t scheme;
+	int cores;
+	const scheduler_policy_ops* policy;
+	priqueue_t ready_queue; // jobs waiting for a core, best first
+	job_ring_t ready_rings[MLFQ_MAX_LEVELS]; // jobs waiting for a core in turn, one line per level, for policies that use them instead
+	int levels; // MLFQ: ready_rings in use (round robin only uses ready_rings[0])
+	int quanta[MLFQ_MAX_LEVELS]; // MLFQ: time units a job runs on each level before it is demoted
+	int boost_period; // MLFQ: how often every job goes back to the top level (0 for never)
+	int next_boost;
+	priqueue_t running_jobs; // jobs on a core, by the same order as ready_queue; the tail is the preemption victim
+	job_t** core_jobs; // the job running on each core (NULL if idle)
+	unsigned long* idle_cores; // bit i of word i / CORE_WORD_BITS is set while core i is idle
 
-// stats
-int total_jobs = 0;
-float total_waiting_time = 0.0;
-float total_turnaround_time = 0.0;
-float total_response_time = 0.0;
+	// stats
+	int total_jobs;
+	float total_waiting_time;
+	float total_turnaround_time;
+	float total_response_time;
+};
 
-// comparison functions for different scheduling algorithms
-int fcfs_compare(const void* a, const void* b) {
+// the instance behind the original (context-free) scheduler_* calls
+static scheduler_t* default_scheduler;
+
+// comparison functions for different scheduling algorithms, written against
+// job_t so typed queues (typed_priqueue.h) can inline them
+static inline int fcfs_cmp(const job_t* job_a, const job_t* job_b) {
 	// order by arrival
-	job_t* job_a = (job_t*)a;
-	job_t* job_b = (job_t*)b;
 	return job_a->arrival_time - job_b->arrival_time;
 }
 
-int sjf_compare(const void* a, const void* b) {
+static inline int sjf_cmp(const job_t* job_a, const job_t* job_b) {
 	// order by total run time
 	// ties broken by arrival time
-	job_t* job_a = (job_t*)a;
-	job_t* job_b = (job_t*)b;
-	
 	if (job_a->run_time == job_b->run_time)
 		return job_a->arrival_time - job_b->arrival_time;
 	return job_a->run_time - job_b->run_time;
 }
 
-int psjf_compare(const void* a, const void* b) {
+static inline int psjf_cmp(const job_t* job_a, const job_t* job_b) {
 	// order by remaining time
-	job_t* job_a = (job_t*)a;
-	job_t* job_b = (job_t*)b;
-	
 	if (job_a->remaining_time == job_b->remaining_time)
 		return job_a->arrival_time - job_b->arrival_time;
 	return job_a->remaining_time - job_b->remaining_time;
 }
 
-int pri_compare(const void* a, const void* b) {
+static inline int pri_cmp(const job_t* job_a, const job_t* job_b) {
 	// order by priority
-	job_t* job_a = (job_t*)a;
-	job_t* job_b = (job_t*)b;
-	
 	if (job_a->priority == job_b->priority)
 		return job_a->arrival_time - job_b->arrival_time;
 	return job_a->priority - job_b->priority;
 }
 
-int rr_compare(const void* a, const void* b) {
+static inline int rr_cmp(const job_t* job_a, const job_t* job_b) {
 	// round robin uses arrival time
-	job_t* job_a = (job_t*)a;
-	job_t* job_b = (job_t*)b;
 	return job_a->arrival_time - job_b->arrival_time;
 }
+
+static inline int mlfq_cmp(const job_t* job_a, const job_t* job_b) {
+	// order by level, then arrival
+	int diff = job_a->level - job_b->level;
+	if (diff == 0) {
+		return job_a->arrival_time - job_b->arrival_time;
+	}
+	return diff;
+}
+
+// the same orderings as priqueue_t comparers
+PRIQUEUE_COMPARER(fcfs_compare, job_t, fcfs_cmp)
+PRIQUEUE_COMPARER(sjf_compare, job_t, sjf_cmp)
+PRIQUEUE_COMPARER(psjf_compare, job_t, psjf_cmp)
+PRIQUEUE_COMPARER(pri_compare, job_t, pri_cmp)
+PRIQUEUE_COMPARER(rr_compare, job_t, rr_cmp)
+PRIQUEUE_COMPARER(mlfq_compare, job_t, mlfq_cmp)
+
+// integer keys for the bucket queue; each orders jobs the same way as the
+// comparer it stands in for, given that jobs are offered in arrival order
+int arrival_key(const void* a) {
+	return ((job_t*)a)->arrival_time;
+}
+
+int priority_key(const void* a) {
+	return ((job_t*)a)->priority;
+}
+
+// 64-bit sort keys for keyed heaps: the primary field in the high half and
+// the arrival time (the comparers' tie-break) in the low half. The primary is
+// multiplied up rather than shifted, since priorities read from the input may
+// be negative (and shifting a negative value is undefined)
+long long arrival_sort_key(const void* a) {
+	return ((job_t*)a)->arrival_time;
+}
+
+long long sjf_sort_key(const void* a) {
+	const job_t* job = a;
+	return (long long)job->run_time * (1LL << 32) + (unsigned int)job->arrival_time;
+}
+
+long long psjf_sort_key(const void* a) {
+	const job_t* job = a;
+	return (long long)job->remaining_time * (1LL << 32) + (unsigned int)job->arrival_time;
+}
+
+long long pri_sort_key(const void* a) {
+	const job_t* job = a;
+	return (long long)job->priority * (1LL << 32) + (unsigned int)job->arrival_time;
+}
+
+long long mlfq_sort_key(const void* a) {
+	const job_t* job = a;
+	return (long long)job->level * (1LL << 32) + (unsigned int)job->arrival_time;
+}
+ 
+// lazy functions
+// get the lowest idle core, a word of cores at a time
+int find_available_core(scheduler_t* s) {
+	int words = (s->cores + CORE_WORD_BITS - 1) / CORE_WORD_BITS;
+	for (int w = 0; w < words; w++) {
+		if (s->idle_cores[w] != 0) {
+			return w * CORE_WORD_BITS + __builtin_ctzl(s->idle_cores[w]);
+		}
+	}
+	return -1;
+}
+// charge every running job for the time it has run since it was last updated,
+// and move it to its new place among the running jobs (PSJF orders by remaining time)
+void update_remaining_times(scheduler_t* s, int time) {
+	for (int i = 0; i < s->cores; i++) {
+		job_t* job = s->core_jobs[i];
+		if (job) {
+			job->remaining_time -= time - job->last_run_time;
+			job->last_run_time = time;
+			priqueue_update(&s->running_jobs, job->running_node);
+		}
+	}
+}
+// put job on core, starting the clock on it
+void run_on_core(scheduler_t* s, job_t* job, int core, int time) {
+	job->current_core = core;
+	job->last_run_time = time;
+	job->slice_start = time;
+	job->running_node = priqueue_offer_handle(&s->running_jobs, job);
+	s->core_jobs[core] = job;
+	s->idle_cores[core / CORE_WORD_BITS] &= ~(1UL << (core % CORE_WORD_BITS));
+	
+	// if this is the first time the job runs, record the time
+	if (job->first_run_time == -1) {
+		job->first_run_time = time;
+	}
+}
+// take job off its core (leaving the core idle)
+void stop_running(scheduler_t* s, job_t* job) {
+	priqueue_remove_handle(&s->running_jobs, job->running_node);
+	s->core_jobs[job->current_core] = NULL;
+	s->idle_cores[job->current_core / CORE_WORD_BITS] |= 1UL << (job->current_core % CORE_WORD_BITS);
+	job->current_core = -1;
+}
+// run the best ready job (if any) on core & return its id, or -1 if core stays idle
+int dispatch(scheduler_t* s, int core, int time) {
+	job_t* job = s->policy->pick_next(s);
+	if (job == NULL) {
+		return -1;
+	}
+	run_on_core(s, job, core, time);
+	return job->job_id;
+}
+// policy hooks
+
+// arrival times and priorities are small integers, and jobs enter the ready
+// queue in an order that already breaks their ties, so a bucket queue offers
+// and polls in O(1); otherwise a keyed heap compares the cached
+// (primary, arrival) keys in O(log n)
+void init_by_arrival(scheduler_t* s) {
+	priqueue_init_bucket(&s->ready_queue, arrival_key);
+}
+void init_by_priority(scheduler_t* s) {
+	priqueue_init_bucket(&s->ready_queue, priority_key);
+}
+void init_by_sort_key(scheduler_t* s) {
+	priqueue_init_keyed(&s->ready_queue, s->policy->sort_key, PRIQUEUE_HEAP);
+}
+void destroy_ready_queue(scheduler_t* s) {
+	priqueue_destroy(&s->ready_queue);
+}
+void enqueue_ready(scheduler_t* s, job_t* job) {
+	priqueue_offer(&s->ready_queue, job);
+}
+job_t* pick_ready(scheduler_t* s) {
+	return priqueue_poll(&s->ready_queue);
+}
+int shorter_remaining(job_t* new_job, job_t* running_job) {
+	return new_job->remaining_time < running_job->remaining_time;
+}
+int higher_priority(job_t* new_job, job_t* running_job) {
+	return new_job->priority < running_job->priority;
+}
+int higher_level(job_t* new_job, job_t* running_job) {
+	return new_job->level < running_job->level;
+}
+// add job at the back of ring, doubling it (& unwrapping the jobs) when full
+void ring_push(job_ring_t* ring, job_t* job) {
+	if (ring->count == ring->capacity) {
+		int capacity = ring->capacity == 0 ? RING_MIN_CAPACITY : ring->capacity * 2;
+		job_t** jobs = malloc(sizeof(job_t*) * capacity);
+		for (int i = 0; i < ring->count; i++) {
+			jobs[i] = ring->jobs[(ring->head + i) & (ring->capacity - 1)];
+		}
+		free(ring->jobs);
+		ring->jobs = jobs;
+		ring->head = 0;
+		ring->capacity = capacity;
+	}
+	ring->jobs[(ring->head + ring->count) & (ring->capacity - 1)] = job;
+	ring->count++;
+}
+// remove & return the job at the front of ring, or NULL if it is empty
+job_t* ring_pop(job_ring_t* ring) {
+	if (ring->count == 0) {
+		return NULL;
+	}
+	job_t* job = ring->jobs[ring->head];
+	ring->head = (ring->head + 1) & (ring->capacity - 1);
+	ring->count--;
+	return job;
+}
+void init_rings(scheduler_t* s) {
+	memset(s->ready_rings, 0, sizeof(s->ready_rings));
+}
+void destroy_rings(scheduler_t* s) {
+	for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+		free(s->ready_rings[i].jobs);
+	}
+	init_rings(s);
+}
+void enqueue_ring(scheduler_t* s, job_t* job) {
+	ring_push(&s->ready_rings[job->level], job);
+}
+// the front job of the highest non-empty level (rings past the levels in use
+// stay empty)
+job_t* pick_ring(scheduler_t* s) {
+	for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+		if (s->ready_rings[i].count > 0) {
+			return ring_pop(&s->ready_rings[i]);
+		}
+	}
+	return NULL;
+}
+// round robin: every quantum ends the job's turn, so it goes to the back of
+// the line (time is only there to match the on_quantum hook)
+void rotate(scheduler_t* s, job_t* job, int time) {
+	(void)time;
+	stop_running(s, job);
+	s->policy->enqueue(s, job);
+}
+// every boost_period, put every job back on the top level so long jobs
+// can't starve behind a stream of short ones
+void boost(scheduler_t* s, int time) {
+	if (s->boost_period <= 0 || time < s->next_boost) {
+		return;
+	}
+	s->next_boost = time - time % s->boost_period + s->boost_period;
+	
+	for (int i = 1; i < s->levels; i++) {
+		job_t* job;
+		while ((job = ring_pop(&s->ready_rings[i])) != NULL) {
+			job->level = 0;
+			ring_push(&s->ready_rings[0], job);
+		}
+	}
+	// running jobs start a fresh level-0 quantum too, rather than being judged
+	// on time they spent on a lower level
+	for (int i = 0; i < s->cores; i++) {
+		job_t* job = s->core_jobs[i];
+		if (job) {
+			job->slice_start = time;
+			if (job->level != 0) {
+				job->level = 0;
+				priqueue_update(&s->running_jobs, job->running_node);
+			}
+		}
+	}
+}
+// once job has used up its level's quantum, move it down a level and to the
+// back of that level's line
+void demote(scheduler_t* s, job_t* job, int time) {
+	boost(s, time);
+	if (time - job->slice_start < s->quanta[job->level]) {
+		return; // keep running
+	}
+	stop_running(s, job);
+	if (job->level < s->levels - 1) {
+		job->level++;
+	}
+	s->policy->enqueue(s, job);
+}
+// running jobs, then the waiting jobs in the order they will get a turn
+void show_rings(scheduler_t* s) {
+	priqueue_iter_t running;
+	for (job_t* job = priqueue_iter_begin(&s->running_jobs, &running); job != NULL; job = priqueue_iter_next(&running)) {
+		printf("%d(%d) ", job->job_id, job->current_core);
+	}
+	for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+		job_ring_t* ring = &s->ready_rings[i];
+		for (int j = 0; j < ring->count; j++) {
+			job_t* job = ring->jobs[(ring->head + j) & (ring->capacity - 1)];
+			printf("%d(%d) ", job->job_id, job->current_core);
+		}
+	}
+	printf("\n");
+}
+
+static const scheduler_policy_ops fcfs_policy = {
+	.compare = fcfs_compare, .sort_key = arrival_sort_key,
+	.init = init_by_arrival, .destroy = destroy_ready_queue,
+	.enqueue = enqueue_ready, .pick_next = pick_ready,
+	.uses_ready_queue = 1,
+};
+static const scheduler_policy_ops sjf_policy = {
+	.compare = sjf_compare, .sort_key = sjf_sort_key,
+	.init = init_by_sort_key, .destroy = destroy_ready_queue,
+	.enqueue = enqueue_ready, .pick_next = pick_ready,
+	.uses_ready_queue = 1,
+};
+static const scheduler_policy_ops psjf_policy = {
+	.compare = psjf_compare, .sort_key = psjf_sort_key,
+	.init = init_by_sort_key, .destroy = destroy_ready_queue,
+	.enqueue = enqueue_ready, .pick_next = pick_ready,
+	.uses_ready_queue = 1,
+	.should_preempt = shorter_remaining,
+	.on_tick = update_remaining_times, // running jobs' order changes as they run
+};
+static const scheduler_policy_ops pri_policy = {
+	.compare = pri_compare, .sort_key = pri_sort_key,
+	.init = init_by_priority, .destroy = destroy_ready_queue,
+	.enqueue = enqueue_ready, .pick_next = pick_ready,
+	.uses_ready_queue = 1,
+};
+// preempted jobs re-enter the ready queue, so ties need the arrival time,
+// not the bucket queue's offer order
+static const scheduler_policy_ops ppri_policy = {
+	.compare = pri_compare, .sort_key = pri_sort_key,
+	.init = init_by_sort_key, .destroy = destroy_ready_queue,
+	.enqueue = enqueue_ready, .pick_next = pick_ready,
+	.uses_ready_queue = 1,
+	.should_preempt = higher_priority,
+};
+static const scheduler_policy_ops rr_policy = {
+	.compare = rr_compare, .sort_key = arrival_sort_key,
+	.init = init_rings, .destroy = destroy_rings,
+	.enqueue = enqueue_ring, .pick_next = pick_ring,
+	.on_quantum = rotate, .show = show_rings,
+};
+static const scheduler_policy_ops mlfq_policy = {
+	.compare = mlfq_compare, .sort_key = mlfq_sort_key,
+	.init = init_rings, .destroy = destroy_rings,
+	.enqueue = enqueue_ring, .pick_next = pick_ring,
+	.should_preempt = higher_level, // new jobs start on the top level
+	.on_tick = boost,
+	.on_quantum = demote, .show = show_rings,
+};
+
+static const scheduler_policy_ops* const policies[] = {
+	[FCFS] = &fcfs_policy,
+	[SJF] = &sjf_policy,
+	[PSJF] = &psjf_policy,
+	[PRI] = &pri_policy,
+	[PPRI] = &ppri_policy,
+	[RR] = &rr_policy,
+	[MLFQ] = &mlfq_policy,
+};
  
 /**
-  Initalizes the scheduler.
+  Creates a scheduler.
+ 
+  Each scheduler keeps its own jobs, cores and statistics, so separate
+  instances may be driven from separate threads (one thread per instance).
  
   Assumptions:
-    - You may assume this will be the first scheduler function called.
-    - You may assume this function will be called once once.
     - You may assume that cores is a positive, non-zero number.
     - You may assume that scheme is a valid scheduling scheme.
 
   @param cores the number of cores that is available by the scheduler. These cores will be known as core(id=0), core(id=1), ..., core(id=cores-1).
   @param scheme  the scheduling scheme that should be used. This value will be one of the six enum values of scheme_t
+  @return a new scheduler, to be freed with scheduler_destroy()
 */
-void scheduler_start_up(int cores, scheme_t scheme)
+scheduler_t* scheduler_create(int cores, scheme_t scheme)
 {
-	// set globals
-	scheduler_cores = cores;
-	scheduler_scheme = scheme;
+	scheduler_t* s = calloc(1, sizeof(scheduler_t));
+	s->cores = cores;
+	s->scheme = scheme;
 	
 	// keep track of cores
-	core_job_map = malloc(sizeof(int) * cores);
+	s->core_jobs = calloc(cores, sizeof(job_t*)); // all idle
+	int words = (cores + CORE_WORD_BITS - 1) / CORE_WORD_BITS;
+	s->idle_cores = calloc(words, sizeof(unsigned long));
 	for (int i = 0; i < cores; i++) {
-		core_job_map[i] = -1;  // -1 means no job assigned
+		s->idle_cores[i / CORE_WORD_BITS] |= 1UL << (i % CORE_WORD_BITS);
 	}
 	
-	// initialize the priority queue with the appropriate comparison function
-	switch (scheme) {
-		case FCFS:
-			priqueue_init(&job_queue, fcfs_compare);
-			break;
-		case SJF:
-			priqueue_init(&job_queue, sjf_compare);
-			break;
-		case PSJF:
-			priqueue_init(&job_queue, psjf_compare);
-			break;
-		case PRI:
-			priqueue_init(&job_queue, pri_compare);
-			break;
-		case PPRI:
-			priqueue_init(&job_queue, pri_compare);
-			break;
-		case RR:
-			priqueue_init(&job_queue, rr_compare);
-			break;
+	s->policy = policies[scheme];
+	s->policy->init(s);
+	if (scheme == MLFQ) {
+		scheduler_set_mlfq_r(s, sizeof(mlfq_default_quanta) / sizeof(int), mlfq_default_quanta, MLFQ_DEFAULT_BOOST_PERIOD);
 	}
+	
+	// a min-max heap finds the worst running job in O(1); keyed, so its sifts
+	// compare cached keys rather than dereferencing two jobs per step
+	priqueue_init_keyed(&s->running_jobs, s->policy->sort_key, PRIQUEUE_MINMAX);
+	priqueue_reserve(&s->running_jobs, cores);
+	
+	return s;
 }
 
-// lazy functions
-// get available cores
-int find_available_core() {
-	for (int i = 0; i < scheduler_cores; i++) {
-		if (core_job_map[i] == -1) {
-			return i;
-		}
-	}
-	return -1;
-}
-// get job by id
-job_t* find_job_by_id(int job_id) {
-	int size = priqueue_size(&job_queue);
-	for (int i = 0; i < size; i++) {
-		job_t* job = (job_t*)priqueue_at(&job_queue, i);
-		if (job->job_id == job_id) {
-			return job;
-		}
-	}
-	return NULL;
-}
-int should_preempt(job_t* new_job, job_t* current_job) {
-	if (scheduler_scheme == PSJF) {
-		return new_job->remaining_time < current_job->remaining_time;
-	}
-	else if (scheduler_scheme == PPRI) {
-		return new_job->priority < current_job->priority;
-	}
-	return 0;  // no preemption
+/**
+  Sets up the levels of an MLFQ scheduler, replacing the defaults (three
+  levels with quanta of 2, 4 and 8, boosted every 50 time units).
+
+  A new job starts on level 0. A job that runs for its level's whole quantum
+  moves down a level (staying on the last), and every boost_period time
+  units all jobs move back to level 0. The scheduler expects
+  scheduler_quantum_expired() on every time unit a core is busy, and decides
+  itself when a quantum is up.
+
+  Assumptions:
+    - This will be called before any jobs arrive.
+    - levels is between 1 and MLFQ_MAX_LEVELS and every quantum is positive.
+
+  @param levels the number of levels
+  @param quanta the time units a job may run on each level before it is demoted
+  @param boost_period how often every job is moved back to the top level (0 for never)
+*/
+void scheduler_set_mlfq_r(scheduler_t* s, int levels, const int* quanta, int boost_period)
+{
+	s->levels = levels;
+	memcpy(s->quanta, quanta, sizeof(int) * levels);
+	s->boost_period = boost_period;
+	s->next_boost = boost_period;
 }
  
 /**
@@ -182,7 +532,7 @@ int should_preempt(job_t* new_job, job_t* current_job) {
   @return -1 if no scheduling changes should be made. 
  
  */
-int scheduler_new_job(int job_number, int time, int running_time, int priority)
+int scheduler_new_job_r(scheduler_t* s, int job_number, int time, int running_time, int priority)
 {
 	// create a new job
 	job_t* new_job = malloc(sizeof(job_t));
@@ -194,49 +544,44 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
 	new_job->first_run_time = -1;
 	new_job->completion_time = -1;
 	new_job->current_core = -1;
+	new_job->last_run_time = time;
+	new_job->level = 0;
 	
-	total_jobs++; // for stats
+	s->total_jobs++; // for stats
 	
-	priqueue_offer(&job_queue, new_job); // add the job to the queue
+	if (s->policy->on_tick) {
+		s->policy->on_tick(s, time);
+	}
 	
 	// first check if any core is available
-	int core = find_available_core();
+	int core = find_available_core(s);
 	if (core != -1) {
-		// assign the job to this core
-		core_job_map[core] = job_number;
-		new_job->current_core = core;
+		run_on_core(s, new_job, core, time);
 		return core;
 	}
 	
 	// if no cores are available and this is a preemptive scheme,
 	// check if this job should preempt any running job
-	if (scheduler_scheme == PSJF || scheduler_scheme == PPRI) {
-		// find the job with the lowest priority (highest value) or longest remaining time
-		int preempt_core = -1;
-		job_t* preempt_job = NULL;
+	if (s->policy->should_preempt) {
+		// only the job with the lowest priority (highest value) or longest
+		// remaining time is worth preempting; among equals, the latest arrival
+		job_t* preempt_job = priqueue_peek_max(&s->running_jobs);
 		
-		for (int i = 0; i < scheduler_cores; i++) {
-			int running_job_id = core_job_map[i];
-			job_t* running_job = find_job_by_id(running_job_id);
-			
-			if (running_job && should_preempt(new_job, running_job)) {
-				if (preempt_core == -1 || should_preempt(running_job, preempt_job)) {
-					preempt_core = i;
-					preempt_job = running_job;
-				}
+		if (preempt_job && s->policy->should_preempt(new_job, preempt_job)) {
+			int preempt_core = preempt_job->current_core;
+			stop_running(s, preempt_job);
+			// a job preempted in the same time unit it was dispatched never ran
+			if (preempt_job->first_run_time == time) {
+				preempt_job->first_run_time = -1;
 			}
-		}
-		
-		if (preempt_core != -1) {
-			preempt_job->current_core = -1; // update the preempted job
-			//assign the new job to this core
-			core_job_map[preempt_core] = job_number;
-			new_job->current_core = preempt_core;
+			s->policy->enqueue(s, preempt_job); // the preempted job waits again
+			run_on_core(s, new_job, preempt_core, time);
 			return preempt_core;
 		}
 	}
 	
-	return -1; // no preemption or available cores
+	s->policy->enqueue(s, new_job); // no preemption or available cores
+	return -1;
 }
  
 /**
@@ -253,10 +598,13 @@ int scheduler_new_job(int job_number, int time, int running_time, int priority)
   @return job_number of the job that should be scheduled to run on core core_id
   @return -1 if core should remain idle.
  */
-int scheduler_job_finished(int core_id, int job_number, int time)
+int scheduler_job_finished_r(scheduler_t* s, int core_id, int job_number, int time)
 {
+	// core_jobs already says which job was on the core; the number is redundant
+	(void)job_number;
+	
 	// find the job that just finnished
-	job_t* finished_job = find_job_by_id(job_number);
+	job_t* finished_job = s->core_jobs[core_id];
 	if (finished_job) {
 		// mark the job as completed
 		finished_job->completion_time = time;
@@ -265,44 +613,22 @@ int scheduler_job_finished(int core_id, int job_number, int time)
 		float turnaround_time = time - finished_job->arrival_time;
 		float waiting_time = turnaround_time - finished_job->run_time;
 		float response_time = finished_job->first_run_time - finished_job->arrival_time;
-		total_turnaround_time += turnaround_time;
-		total_waiting_time += waiting_time;
-		total_response_time += response_time;
+		s->total_turnaround_time += turnaround_time;
+		s->total_waiting_time += waiting_time;
+		s->total_response_time += response_time;
 		
-		priqueue_remove(&job_queue, finished_job); // remove the job from the queue
+		stop_running(s, finished_job);
 		free(finished_job);
 	}
 	
-	core_job_map[core_id] = -1; // mark the core as available
-	
-	// see if there's a job that can run on this core
-	if (priqueue_size(&job_queue) > 0) {
-		// get the highest priority job that isn't running
-		int queue_size = priqueue_size(&job_queue);
-		for (int i = 0; i < queue_size; i++) {
-			job_t* next_job = (job_t*)priqueue_at(&job_queue, i);
-			if (next_job->current_core == -1) {
-				// found a job that isn't running
-				next_job->current_core = core_id;
-				core_job_map[core_id] = next_job->job_id;
-				
-				// if this is the first time the job runs, record the time
-				if (next_job->first_run_time == -1) {
-					next_job->first_run_time = time;
-				}
-				
-				return next_job->job_id;
-			}
-		}
-	}
-	
-	return -1; // no nunnable jobs available
+	// run the highest priority waiting job on this core, if there is one
+	return dispatch(s, core_id, time);
 }
  
 
 /**
-  When the scheme is set to RR, called when the quantum timer has expired
-  on a core.
+  When the scheme is set to RR (or MLFQ), called when the quantum timer has
+  expired on a core.
  
   If any job should be scheduled to run on the core free'd up by
   the quantum expiration, return the job_number of the job that should be
@@ -313,49 +639,25 @@ int scheduler_job_finished(int core_id, int job_number, int time)
   @return job_number of the job that should be scheduled on core cord_id
   @return -1 if core should remain idle
  */
-int scheduler_quantum_expired(int core_id, int time)
+int scheduler_quantum_expired_r(scheduler_t* s, int core_id, int time)
 {
-	// only relevant for Round Robin
-	if (scheduler_scheme != RR) {
-		return core_job_map[core_id]; // keep the current job
-	}
-	
 	// find the job currently running on this core
-	int current_job_id = core_job_map[core_id];
-	job_t* current_job = find_job_by_id(current_job_id);
-	
-	if (current_job) {
-		// remove and readd to move to back to queue
-		priqueue_remove(&job_queue, current_job);
-		
-		current_job->arrival_time = time; // update the job's virtual arrival time to ensure it goes to the back
-		current_job->current_core = -1; // mark the job as not running on any core
+	job_t* current_job = s->core_jobs[core_id];
 	
-		// add it back to the queue
-		priqueue_offer(&job_queue, current_job);
+	// only relevant for schemes with a time slice (Round Robin)
+	if (s->policy->on_quantum == NULL) {
+		return current_job ? current_job->job_id : -1; // keep the current job
 	}
 	
-	core_job_map[core_id] = -1; // mark the core as available
-	
-	// find the next job to run (the job at the front of the queue that isn't running)
-	int queue_size = priqueue_size(&job_queue);
-	for (int i = 0; i < queue_size; i++) {
-		job_t* next_job = (job_t*)priqueue_at(&job_queue, i);
-		if (next_job->current_core == -1) {
-			// assign this job to the core
-			next_job->current_core = core_id;
-			core_job_map[core_id] = next_job->job_id;
-			
-			// if this is the first time the job runs, record the time
-			if (next_job->first_run_time == -1) {
-				next_job->first_run_time = time;
-			}
-			
-			return next_job->job_id;
+	if (current_job) {
+		s->policy->on_quantum(s, current_job, time);
+		if (s->core_jobs[core_id]) {
+			return s->core_jobs[core_id]->job_id; // the policy kept it running
 		}
 	}
 	
-	return -1; // no jobs available to run
+	// run the job at the front of the queue
+	return dispatch(s, core_id, time);
 }
 
 
@@ -366,10 +668,10 @@ int scheduler_quantum_expired(int core_id, int time)
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average waiting time of all jobs scheduled.
  */
-float scheduler_average_waiting_time()
+float scheduler_average_waiting_time_r(scheduler_t* s)
 {
-	if (total_jobs == 0) return 0.0;
-	return total_waiting_time / total_jobs;
+	if (s->total_jobs == 0) return 0.0;
+	return s->total_waiting_time / s->total_jobs;
 }
  
 
@@ -380,10 +682,10 @@ float scheduler_average_waiting_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average turnaround time of all jobs scheduled.
  */
-float scheduler_average_turnaround_time()
+float scheduler_average_turnaround_time_r(scheduler_t* s)
 {
-	if (total_jobs == 0) return 0.0;
-	return total_turnaround_time / total_jobs;
+	if (s->total_jobs == 0) return 0.0;
+	return s->total_turnaround_time / s->total_jobs;
 }
 
 
@@ -394,31 +696,37 @@ float scheduler_average_turnaround_time()
     - This function will only be called after all scheduling is complete (all jobs that have arrived will have finished and no new jobs will arrive).
   @return the average response time of all jobs scheduled.
  */
-float scheduler_average_response_time()
+float scheduler_average_response_time_r(scheduler_t* s)
 {
-	if (total_jobs == 0) return 0.0;
-	return total_response_time / total_jobs;
+	if (s->total_jobs == 0) return 0.0;
+	return s->total_response_time / s->total_jobs;
 }
  
 /**
-  Free any memory associated with your scheduler.
+  Free any memory associated with a scheduler, including s itself.
  
   Assumption:
-    - This function will be the last function called in your library.
+    - This function will be the last function called on s.
 */
-void scheduler_clean_up()
+void scheduler_destroy(scheduler_t* s)
 {
-	// free all jobs in the queue
-	while (priqueue_size(&job_queue) > 0) {
-		job_t* job = priqueue_poll(&job_queue);
+	// free all jobs still waiting or running
+	job_t* job;
+	while ((job = s->policy->pick_next(s)) != NULL) {
 		free(job);
 	}
+	for (int i = 0; i < s->cores; i++) {
+		free(s->core_jobs[i]);
+	}
 
-	// destroy the priority queue
-	priqueue_destroy(&job_queue);
+	// destroy the priority queues
+	s->policy->destroy(s);
+	priqueue_destroy(&s->running_jobs);
 
 	// free the core job map
-	free(core_job_map);
+	free(s->core_jobs);
+	free(s->idle_cores);
+	free(s);
 }
  
 
@@ -433,12 +741,128 @@ void scheduler_clean_up()
   This function is not required and will not be graded. You may leave it
   blank if you do not find it useful.
  */
-void scheduler_show_queue()
+void scheduler_show_queue_r(scheduler_t* s)
 {
-	int size = priqueue_size(&job_queue);
-	for (int i = 0; i < size; i++) {
-		job_t* job = (job_t*)priqueue_at(&job_queue, i);
-		printf("%d(%d) ", job->job_id, job->current_core);
+	// this is only debugging output, so keep the iterators' snapshot sorts out
+	// of the queues' operation counters; they aren't scheduling work
+	priqueue_pause_stats(&s->ready_queue, 1);
+	priqueue_pause_stats(&s->running_jobs, 1);
+	
+	if (s->policy->show) {
+		s->policy->show(s);
 	}
-	printf("\n");
-}
\ No newline at end of file
+	else {
+		// merge the running and ready jobs back into one view, in scheme order
+		// (a running job goes first when the two tie)
+		priqueue_iter_t running, ready;
+		job_t* run = priqueue_iter_begin(&s->running_jobs, &running);
+		job_t* wait = priqueue_iter_begin(&s->ready_queue, &ready);
+		while (run != NULL || wait != NULL) {
+			if (wait == NULL || (run != NULL && s->policy->compare(run, wait) <= 0)) {
+				printf("%d(%d) ", run->job_id, run->current_core);
+				run = priqueue_iter_next(&running);
+			}
+			else {
+				printf("%d(%d) ", wait->job_id, wait->current_core);
+				wait = priqueue_iter_next(&ready);
+			}
+		}
+		printf("\n");
+	}
+	
+	priqueue_pause_stats(&s->ready_queue, 0);
+	priqueue_pause_stats(&s->running_jobs, 0);
+}
+
+
+// prints one queue's operation counters on a single line
+static void show_stats(const char* name, priqueue_t* q) {
+	const priqueue_stats_t* stats = priqueue_get_stats(q);
+	printf("  %-12s offers=%lu polls=%lu removes=%lu comparisons=%lu nodes_walked=%lu max_size=%d\n",
+		name, stats->offers, stats->polls, stats->removes, stats->comparisons, stats->nodes_walked, stats->max_size);
+}
+
+/**
+  Prints the operation counters of the scheduler's priority queues.
+
+  The counters are only kept when the queues are built with -DPRIQUEUE_STATS
+  (see priqueue_get_stats); otherwise every count is zero. Must be called
+  before scheduler_clean_up(), which destroys the queues.
+*/
+void scheduler_show_queue_stats_r(scheduler_t* s)
+{
+	printf("Queue Stats:\n");
+	if (s->policy->uses_ready_queue) {
+		show_stats("ready_queue", &s->ready_queue);
+	}
+	show_stats("running_jobs", &s->running_jobs);
+}
+
+
+// the original API, each call forwarding to the default instance
+
+/**
+  Initalizes the default scheduler.
+ 
+  Assumptions:
+    - You may assume this will be the first scheduler function called.
+    - You may assume this function will be called once once.
+
+  @param cores the number of cores that is available by the scheduler.
+  @param scheme  the scheduling scheme that should be used.
+*/
+void scheduler_start_up(int cores, scheme_t scheme)
+{
+	default_scheduler = scheduler_create(cores, scheme);
+}
+
+void scheduler_set_mlfq(int levels, const int* quanta, int boost_period)
+{
+	scheduler_set_mlfq_r(default_scheduler, levels, quanta, boost_period);
+}
+
+int scheduler_new_job(int job_number, int time, int running_time, int priority)
+{
+	return scheduler_new_job_r(default_scheduler, job_number, time, running_time, priority);
+}
+
+int scheduler_job_finished(int core_id, int job_number, int time)
+{
+	return scheduler_job_finished_r(default_scheduler, core_id, job_number, time);
+}
+
+int scheduler_quantum_expired(int core_id, int time)
+{
+	return scheduler_quantum_expired_r(default_scheduler, core_id, time);
+}
+
+float scheduler_average_waiting_time()
+{
+	return scheduler_average_waiting_time_r(default_scheduler);
+}
+
+float scheduler_average_turnaround_time()
+{
+	return scheduler_average_turnaround_time_r(default_scheduler);
+}
+
+float scheduler_average_response_time()
+{
+	return scheduler_average_response_time_r(default_scheduler);
+}
+
+void scheduler_clean_up()
+{
+	scheduler_destroy(default_scheduler);
+	default_scheduler = NULL;
+}
+
+void scheduler_show_queue()
+{
+	scheduler_show_queue_r(default_scheduler);
+}
+
+void scheduler_show_queue_stats()
+{
+	scheduler_show_queue_stats_r(default_scheduler);
+}
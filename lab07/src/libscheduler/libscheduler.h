@@ -7,9 +7,20 @@
 /**
   Constants which represent the different scheduling algorithms
 */
-typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR} scheme_t;
+typedef enum {FCFS = 0, SJF, PSJF, PRI, PPRI, RR, MLFQ} scheme_t;
+
+/**
+  The most levels an MLFQ scheduler may have (see scheduler_set_mlfq)
+*/
+#define MLFQ_MAX_LEVELS 8
+
+/**
+  How often MLFQ moves every job back to the top level, unless scheduler_set_mlfq says otherwise
+*/
+#define MLFQ_DEFAULT_BOOST_PERIOD 50
 
 void  scheduler_start_up               (int cores, scheme_t scheme);
+void  scheduler_set_mlfq               (int levels, const int* quanta, int boost_period);
 int   scheduler_new_job                (int job_number, int time, int running_time, int priority);
 int   scheduler_job_finished           (int core_id, int job_number, int time);
 int   scheduler_quantum_expired        (int core_id, int time);
@@ -19,5 +30,26 @@ float scheduler_average_response_time  ();
 void  scheduler_clean_up               ();
 
 void  scheduler_show_queue             ();
+void  scheduler_show_queue_stats       ();
+
+/**
+  A scheduler instance. The calls above drive a single default instance;
+  the _r calls below take the instance explicitly, so several simulations
+  can run side by side (each instance used by one thread at a time).
+*/
+typedef struct _scheduler_t scheduler_t;
+
+scheduler_t* scheduler_create                   (int cores, scheme_t scheme);
+void         scheduler_set_mlfq_r               (scheduler_t* s, int levels, const int* quanta, int boost_period);
+int          scheduler_new_job_r                (scheduler_t* s, int job_number, int time, int running_time, int priority);
+int          scheduler_job_finished_r           (scheduler_t* s, int core_id, int job_number, int time);
+int          scheduler_quantum_expired_r        (scheduler_t* s, int core_id, int time);
+float        scheduler_average_turnaround_time_r(scheduler_t* s);
+float        scheduler_average_waiting_time_r   (scheduler_t* s);
+float        scheduler_average_response_time_r  (scheduler_t* s);
+void         scheduler_destroy                  (scheduler_t* s);
+
+void         scheduler_show_queue_r             (scheduler_t* s);
+void         scheduler_show_queue_stats_r       (scheduler_t* s);
 
 #endif /* LIBSCHEDULER_H_ */
@@ -0,0 +1,224 @@
+/** @file queuebench.c
+ *
+ * Times every priqueue_t backend across queue sizes and key distributions.
+ *
+ *   ./queuebench [max_size] [backend ...]
+ *
+ * Sizes run from 100 up to max_size (default 10000000) by factors of ten.
+ * Each backend/distribution/size combination runs in its own child process,
+ * so the peak RSS column is that combination's alone. Every row has the same
+ * columns in the same order, so two builds' output can be diffed directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "libpriqueue/libpriqueue.h"
+
+/* priqueue_at and priqueue_remove scan or sort the queue on most backends,
+ * so they run on a sample of this many operations' worth of elements */
+#define SAMPLE_WORK 1000000
+#define SAMPLE_MAX 1000
+
+/* list offers walk the queue, so big unsorted inputs would run for hours */
+#define LIST_MAX_UNSORTED 10000
+
+typedef struct
+{
+	const char *name;
+	priqueue_backend_t backend;
+	int keyed;
+} bench_backend_t;
+
+static const bench_backend_t backends[] = {
+	{ "list", PRIQUEUE_LIST, 0 },
+	{ "heap", PRIQUEUE_HEAP, 0 },
+	{ "heapkey", PRIQUEUE_HEAP, 1 },
+	{ "tree", PRIQUEUE_TREE, 0 },
+	{ "bucket", PRIQUEUE_BUCKET, 0 },
+	{ "minmax", PRIQUEUE_MINMAX, 0 },
+	{ "pairing", PRIQUEUE_PAIRING, 0 },
+};
+
+static const char *distributions[] = { "sorted", "reverse", "random", "dups" };
+
+int compare_int(const void * a, const void * b)
+{
+	return *(int*)a - *(int*)b;
+}
+
+int key_int(const void * a)
+{
+	return *(int*)a;
+}
+
+long long sort_key_int(const void * a)
+{
+	return *(int*)a;
+}
+
+double seconds_since(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* keys in [0, n), so the bucket backend spans at most n buckets */
+void fill_keys(int *values, int n, const char *dist)
+{
+	int i;
+
+	srand(678);
+	for (i = 0; i < n; i++) {
+		if (strcmp(dist, "sorted") == 0)
+			values[i] = i;
+		else if (strcmp(dist, "reverse") == 0)
+			values[i] = n - 1 - i;
+		else if (strcmp(dist, "random") == 0)
+			values[i] = rand() % n;
+		else
+			values[i] = rand() % 16;
+	}
+}
+
+void init_bench_queue(priqueue_t *q, const bench_backend_t *b)
+{
+	if (b->backend == PRIQUEUE_BUCKET)
+		priqueue_init_bucket(q, key_int);
+	else if (b->keyed)
+		priqueue_init_keyed(q, sort_key_int, b->backend);
+	else
+		priqueue_init_backend(q, compare_int, b->backend);
+}
+
+void row(const bench_backend_t *b, const char *dist, int n, const char *op, int ops, double secs, long rss)
+{
+	printf("%-8s %-8s %9d %-7s %9d %12.1f %10ld\n",
+		b->name, dist, n, op, ops, ops > 0 ? secs * 1e9 / ops : 0.0, rss);
+}
+
+/* runs one combination (in the calling process) and prints a row per operation */
+void run(const bench_backend_t *b, const char *dist, int n)
+{
+	int *values = malloc(n * sizeof(int));
+	double secs[5];
+	int ops[5];
+	const char *names[5] = { "offer", "peek", "at", "remove", "poll" };
+	struct timespec start;
+	struct rusage usage;
+	volatile void *sink;
+	priqueue_t q;
+	int sample, i;
+
+	fill_keys(values, n, dist);
+	sample = SAMPLE_WORK / n;
+	if (sample < 1)
+		sample = 1;
+	if (sample > SAMPLE_MAX)
+		sample = SAMPLE_MAX;
+	if (sample > n / 2)
+		sample = n / 2;
+
+	init_bench_queue(&q, b);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_offer(&q, &values[i]);
+	secs[0] = seconds_since(&start);
+	ops[0] = n;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		sink = priqueue_peek(&q);
+	secs[1] = seconds_since(&start);
+	ops[1] = n;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < sample; i++)
+		sink = priqueue_at(&q, (int)((long long)i * n / sample));
+	secs[2] = seconds_since(&start);
+	ops[2] = sample;
+
+	/* every element has its own address, so each remove takes exactly one */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < sample; i++)
+		priqueue_remove(&q, &values[(int)((long long)i * n / sample)]);
+	secs[3] = seconds_since(&start);
+	ops[3] = sample;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ops[4] = 0;
+	while (priqueue_poll(&q) != NULL)
+		ops[4]++;
+	secs[4] = seconds_since(&start);
+	(void)sink;
+
+	getrusage(RUSAGE_SELF, &usage);
+	for (i = 0; i < 5; i++)
+		row(b, dist, n, names[i], ops[i], secs[i], usage.ru_maxrss);
+
+	priqueue_destroy(&q);
+	free(values);
+}
+
+int selected(const bench_backend_t *b, int argc, char **argv)
+{
+	int i;
+
+	if (argc <= 2)
+		return 1;
+	for (i = 2; i < argc; i++)
+		if (strcmp(argv[i], b->name) == 0)
+			return 1;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int max_size = argc > 1 ? atoi(argv[1]) : 10000000;
+	size_t nb, nd;
+	long n;
+
+	printf("%-8s %-8s %9s %-7s %9s %12s %10s\n", "backend", "dist", "size", "op", "ops", "ns/op", "rss_kb");
+
+	for (nb = 0; nb < sizeof(backends) / sizeof(backends[0]); nb++) {
+		const bench_backend_t *b = &backends[nb];
+		if (!selected(b, argc, argv))
+			continue;
+
+		for (nd = 0; nd < sizeof(distributions) / sizeof(distributions[0]); nd++) {
+			const char *dist = distributions[nd];
+
+			for (n = 100; n <= max_size; n *= 10) {
+				pid_t pid;
+
+				if (b->backend == PRIQUEUE_LIST && n > LIST_MAX_UNSORTED &&
+					(strcmp(dist, "random") == 0 || strcmp(dist, "dups") == 0)) {
+					printf("%-8s %-8s %9ld %-7s %9s %12s %10s\n", b->name, dist, n, "skipped", "-", "-", "-");
+					continue;
+				}
+
+				/* a fresh process per run keeps peak RSS (and the allocator) independent */
+				fflush(stdout);
+				pid = fork();
+				if (pid == 0) {
+					run(b, dist, n);
+					fflush(stdout);
+					_exit(0);
+				}
+				if (pid < 0 || waitpid(pid, NULL, 0) < 0) {
+					perror("queuebench");
+					return 1;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -3,8 +3,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "libpriqueue/libpriqueue.h"
+#include "libpriqueue/typed_priqueue.h"
 
 int compare1(const void * a, const void * b)
 {
@@ -16,12 +19,63 @@ int compare2(const void * a, const void * b)
 	return ( *(int*)b - *(int*)a );
 }
 
-int main()
+int compare_mod10(const void * a, const void * b)
+{
+	return ( *(int*)a % 10 - *(int*)b % 10 );
+}
+
+#define INT_CMP(a, b) (*(a) - *(b))
+DEFINE_PRIQUEUE(int_queue, int, INT_CMP)
+
+/* Integer keys matching compare1/compare2/compare_mod10, for PRIQUEUE_BUCKET. */
+int key1(const void * a)
+{
+	return *(int*)a;
+}
+
+int key2(const void * a)
+{
+	return -*(int*)a;
+}
+
+int key_mod10(const void * a)
+{
+	return *(int*)a % 10;
+}
+
+/* Sort key matching compare1, for keyed heaps. */
+long long sort_key1(const void * a)
+{
+	return *(int*)a;
+}
+
+void init_queue(priqueue_t *q, int(*comparer)(const void *, const void *), priqueue_backend_t backend)
+{
+	if (backend != PRIQUEUE_BUCKET)
+		priqueue_init_backend(q, comparer, backend);
+	else if (comparer == compare1)
+		priqueue_init_bucket(q, key1);
+	else if (comparer == compare2)
+		priqueue_init_bucket(q, key2);
+	else
+		priqueue_init_bucket(q, key_mod10);
+}
+
+int greater_than(void * item, void * limit)
+{
+	return *(int*)item > *(int*)limit;
+}
+
+void test_backend(priqueue_backend_t backend, const char *name)
 {
 	priqueue_t q, q2;
 
-	priqueue_init(&q, compare1);
-	priqueue_init(&q2, compare2);
+	printf("=== %s ===\n", name);
+
+	init_queue(&q, compare1, backend);
+	init_queue(&q2, compare2, backend);
+	priqueue_reserve(&q, 100);
+	printf("Reserved nodes: %d (expected 1)\n", q.pool.capacity >= 100);
 
 	/* Pupulate some data... */
 	int *values = malloc(100 * sizeof(int));
@@ -65,10 +119,726 @@ int main()
 		printf("%d ", *((int *)priqueue_at(&q2, i)) );
 	printf("\n");
 
+	/* Both ends of the queue. */
+	printf("Last element: %d (expected 30).\n", *((int *)priqueue_peek_max(&q)));
+	val = *((int *)priqueue_poll_max(&q2));
+	printf("Polled last element: %d (expected 10).\n", val);
+	printf("Total elements: %d (expected 2).\n", priqueue_size(&q2));
+
+	/* A handle removes exactly its own entry. */
+	node_t *handle = priqueue_offer_handle(&q, &values[15]);
+	priqueue_offer(&q, &values[15]);
+	printf("Removed by handle: %d (expected 15).\n", *((int *)priqueue_remove_handle(&q, handle)));
+	printf("Total elements: %d (expected 6).\n", priqueue_size(&q));
+
+	/* Changing a key in place and calling update repositions the entry. */
+	int key = 12;
+	handle = priqueue_offer_handle(&q, &key);
+	key = 25;
+	priqueue_update(&q, handle);
+	printf("Elements after update (expected 10 13 14 15 20 25 30): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("\n");
+	priqueue_remove_handle(&q, handle);
+
+	/* Iterate in order, removing odd elements along the way. */
+	priqueue_iter_t it;
+	int *item;
+	printf("Iterated elements (expected 10 13 14 15 20 30): ");
+	for (item = priqueue_iter_begin(&q, &it); item != NULL; item = priqueue_iter_next(&it)) {
+		printf("%d ", *item);
+		if (*item % 2)
+			priqueue_iter_remove(&it);
+	}
+	printf("\n");
+	printf("Elements after removing odd ones (expected 10 14 20 30): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("\n");
+
+	int limit = 12;
+	item = priqueue_foreach(&q, greater_than, &limit);
+	printf("First element greater than 12: %d (expected 14).\n", *item);
+
+	priqueue_destroy(&q2);
+	priqueue_destroy(&q);
+
+	/* Equal priorities must come back out in arrival order. */
+	init_queue(&q, compare_mod10, backend);
+	priqueue_offer(&q, &values[31]);
+	priqueue_offer(&q, &values[2]);
+	priqueue_offer(&q, &values[11]);
+	priqueue_offer(&q, &values[22]);
+	priqueue_offer(&q, &values[1]);
+	priqueue_offer(&q, &values[12]);
+
+	printf("Ties in arrival order (expected 31 11 1 2 22 12): ");
+	while (priqueue_size(&q) > 0)
+		printf("%d ", *((int *)priqueue_poll(&q)) );
+	printf("\n");
+
+	priqueue_destroy(&q);
+
+	/* A batch lands as if offered one by one, after queued equals. */
+	void *batch[5] = { &values[21], &values[3], &values[13], &values[1], &values[40] };
+	init_queue(&q, compare_mod10, backend);
+	priqueue_offer_many(&q, batch, 3);
+	priqueue_offer_many(&q, batch + 3, 2);
+
+	printf("Batches in order (expected 40 21 1 3 13): ");
+	while (priqueue_size(&q) > 0)
+		printf("%d ", *((int *)priqueue_poll(&q)) );
+	printf("\n");
+
+	priqueue_destroy(&q);
+
+	/* Merging empties the source; splitting hands over the back half. */
+	init_queue(&q, compare1, backend);
+	init_queue(&q2, compare1, backend);
+	priqueue_offer(&q, &values[30]);
+	priqueue_offer(&q, &values[10]);
+	priqueue_offer(&q2, &values[40]);
+	priqueue_offer(&q2, &values[20]);
+	priqueue_offer(&q2, &values[50]);
+	priqueue_merge(&q, &q2);
+
+	printf("Merged elements (expected 10 20 30 40 50): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("\n");
+	printf("Elements left in source: %d (expected 0).\n", priqueue_size(&q2));
+
+	priqueue_split(&q, &q2);
+	printf("Split halves (expected 10 20 30 | 40 50): ");
+	for (i = 0; i < priqueue_size(&q); i++)
+		printf("%d ", *((int *)priqueue_at(&q, i)) );
+	printf("| ");
+	for (i = 0; i < priqueue_size(&q2); i++)
+		printf("%d ", *((int *)priqueue_at(&q2, i)) );
+	printf("\n\n");
+
 	priqueue_destroy(&q2);
 	priqueue_destroy(&q);
 
 	free(values);
+}
+
+typedef struct _entry_t
+{
+	int value;
+	priqueue_hook_t hook;
+} entry_t;
+
+int compare_entry(const priqueue_hook_t * a, const priqueue_hook_t * b)
+{
+	return PRIQUEUE_ENTRY(a, entry_t, hook)->value - PRIQUEUE_ENTRY(b, entry_t, hook)->value;
+}
+
+void test_intrusive()
+{
+	ipriqueue_t q;
+	entry_t entries[6] = { {.value = 30}, {.value = 10}, {.value = 20}, {.value = 10}, {.value = 40}, {.value = 5} };
+	priqueue_hook_t *hook;
+	int i;
+
+	printf("=== intrusive ===\n");
+
+	ipriqueue_init(&q, compare_entry);
+	for (i = 0; i < 6; i++)
+		ipriqueue_offer(&q, &entries[i].hook);
+	printf("Total elements: %d (expected 6).\n", ipriqueue_size(&q));
+
+	ipriqueue_remove(&q, &entries[4].hook);
+	ipriqueue_remove(&q, &entries[1].hook);
+	printf("Total elements: %d (expected 4).\n", ipriqueue_size(&q));
+
+	printf("Elements in order queue (expected 5 10 20 30): ");
+	for (hook = ipriqueue_peek(&q); hook != NULL; hook = hook->next)
+		printf("%d ", PRIQUEUE_ENTRY(hook, entry_t, hook)->value);
+	printf("\n");
+
+	printf("Polled entries (expected 5 3 2 0): ");
+	while ((hook = ipriqueue_poll(&q)) != NULL)
+		printf("%d ", (int)(PRIQUEUE_ENTRY(hook, entry_t, hook) - entries));
+	printf("\n\n");
+}
+
+void test_typed()
+{
+	int_queue_t q;
+	int values[6] = { 30, 10, 20, 10, 40, 5 };
+	int *item;
+	int i;
+
+	printf("=== typed ===\n");
+
+	int_queue_init(&q);
+	for (i = 0; i < 6; i++)
+		int_queue_offer(&q, &values[i]);
+	printf("Total elements: %d (expected 6).\n", int_queue_size(&q));
+
+	printf("Removed %d (expected 1).\n", int_queue_remove(&q, &values[4]));
+	printf("Top element: %d (expected 5).\n", *int_queue_peek(&q));
+
+	printf("Polled indices (expected 5 1 3 2 0): ");
+	while ((item = int_queue_poll(&q)) != NULL)
+		printf("%d ", (int)(item - values));
+	printf("\n\n");
+
+	int_queue_destroy(&q);
+}
+
+void test_keyed(priqueue_backend_t backend, const char *name)
+{
+	priqueue_t q;
+	int values[6] = { 30, 10, 20, 10, 40, 5 };
+	node_t *handle;
+	int *item;
+	int i;
+
+	printf("=== keyed %s ===\n", name);
+
+	priqueue_init_keyed(&q, sort_key1, backend);
+	for (i = 0; i < 4; i++)
+		priqueue_offer(&q, &values[i]);
+	handle = priqueue_offer_handle(&q, &values[4]);
+	printf("Offered with key: %d (expected 0)\n", priqueue_offer_key(&q, &values[5], values[5]));
+	printf("Tail element: %d (expected 40).\n", *(int *)priqueue_peek_max(&q));
+
+	/* the cached key is only refreshed by priqueue_update */
+	values[4] = 0;
+	priqueue_update(&q, handle);
+	printf("Top element: %d (expected 0).\n", *(int *)priqueue_peek(&q));
+
+	printf("Polled indices (expected 4 5 1 3 2 0): ");
+	while ((item = priqueue_poll(&q)) != NULL)
+		printf("%d ", (int)(item - values));
+	printf("\n");
+
+	priqueue_destroy(&q);
+
+	/* a key means nothing to a queue ordered by its comparer */
+	priqueue_init_backend(&q, compare1, backend);
+	printf("Offered with key to unkeyed queue: %d (expected -1)\n", priqueue_offer_key(&q, &values[0], values[0]));
+	printf("Size: %d (expected 0)\n\n", priqueue_size(&q));
+	priqueue_destroy(&q);
+}
+
+#ifdef PRIQUEUE_STATS
+void test_stats(priqueue_backend_t backend, const char *name)
+{
+	priqueue_t q;
+	int values[6] = { 30, 10, 20, 10, 40, 5 };
+	void *batch[2] = { &values[4], &values[5] };
+	const priqueue_stats_t *stats;
+	int i;
+
+	printf("=== stats %s ===\n", name);
+
+	init_queue(&q, compare1, backend);
+	for (i = 0; i < 4; i++)
+		priqueue_offer(&q, &values[i]);
+	priqueue_offer_many(&q, batch, 2);
+	priqueue_poll(&q);
+	priqueue_poll_max(&q);
+	priqueue_remove(&q, &values[1]);
+	priqueue_remove_at(&q, 1);
+	priqueue_offer(&q, &values[0]);
+
+	stats = priqueue_get_stats(&q);
+	printf("Offers: %lu (expected 7)\n", stats->offers);
+	printf("Polls: %lu (expected 2)\n", stats->polls);
+	printf("Removes: %lu (expected 2)\n", stats->removes);
+	printf("Max size: %d (expected 6)\n", stats->max_size);
+	printf("Compared or walked: %d (expected 1)\n\n", stats->comparisons + stats->nodes_walked > 0);
+
+	priqueue_destroy(&q);
+}
+#endif
+
+void test_radix()
+{
+	radix_heap_t h;
+	int values[6] = { 30, 10, 20, 10, 40, 5 };
+	unsigned int key;
+	int *item;
+	int i;
+
+	printf("=== radix ===\n");
+
+	radix_heap_init(&h);
+	for (i = 0; i < 6; i++)
+		radix_heap_offer(&h, values[i], &values[i]);
+	printf("Total elements: %d (expected 6).\n", radix_heap_size(&h));
+
+	printf("Polled indices (expected 5 1 3 2): ");
+	for (i = 0; i < 4; i++)
+		printf("%d ", (int)((int *)radix_heap_poll(&h, NULL) - values));
+	printf("\n");
+
+	/* keys may repeat the last polled key, but not go below it */
+	radix_heap_offer(&h, 20, &values[2]);
+	radix_heap_offer(&h, 35, &values[0]);
+	printf("Polled keys (expected 20 30 35 40): ");
+	while ((item = radix_heap_poll(&h, &key)) != NULL)
+		printf("%u ", key);
+	printf("\n\n");
+
+	radix_heap_destroy(&h);
+}
+
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_PER_THREAD 1000
+
+typedef struct
+{
+	cpriqueue_t *q;
+	int *values;
+	int *seen;
+	int *taken;
+	int first;
+} concurrent_arg_t;
+
+void *concurrent_producer(void *arg)
+{
+	concurrent_arg_t *a = arg;
+	int i;
+
+	for (i = a->first; i < a->first + CONCURRENT_PER_THREAD; i++)
+		cpriqueue_offer(a->q, &a->values[i]);
+	return NULL;
+}
+
+void *concurrent_consumer(void *arg)
+{
+	concurrent_arg_t *a = arg;
+	int total = CONCURRENT_THREADS * CONCURRENT_PER_THREAD;
+
+	while (__atomic_load_n(a->taken, __ATOMIC_ACQUIRE) < total) {
+		int *item = cpriqueue_poll(a->q);
+		if (item == NULL)
+			continue;
+		__atomic_add_fetch(&a->seen[item - a->values], 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(a->taken, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+void test_concurrent()
+{
+	cpriqueue_t q;
+	int values[CONCURRENT_THREADS * CONCURRENT_PER_THREAD];
+	int seen[CONCURRENT_THREADS * CONCURRENT_PER_THREAD];
+	int total = CONCURRENT_THREADS * CONCURRENT_PER_THREAD;
+	pthread_t producers[CONCURRENT_THREADS], consumers[CONCURRENT_THREADS];
+	concurrent_arg_t args[CONCURRENT_THREADS];
+	int taken = 0, wrong = 0;
+	int i;
+
+	printf("=== concurrent ===\n");
+
+	/* a single lane is an ordinary heap */
+	cpriqueue_init(&q, compare1, 1);
+	for (i = 0; i < 6; i++) {
+		values[i] = (i * 7) % 6;
+		cpriqueue_offer(&q, &values[i]);
+	}
+	printf("Head: %d (expected 0)\n", *(int *)cpriqueue_peek(&q));
+	printf("Polled (expected 0 1 2 3 4 5): ");
+	for (i = 0; i < 6; i++)
+		printf("%d ", *(int *)cpriqueue_poll(&q));
+	printf("\n");
+	printf("Poll on empty: %p (expected (nil))\n", cpriqueue_poll(&q));
+	cpriqueue_destroy(&q);
+
+	/* producers and consumers racing on eight lanes */
+	cpriqueue_init(&q, compare1, 2 * CONCURRENT_THREADS);
+	for (i = 0; i < total; i++) {
+		values[i] = rand() % 1000;
+		seen[i] = 0;
+	}
+	for (i = 0; i < CONCURRENT_THREADS; i++) {
+		args[i].q = &q;
+		args[i].values = values;
+		args[i].seen = seen;
+		args[i].taken = &taken;
+		args[i].first = i * CONCURRENT_PER_THREAD;
+		pthread_create(&producers[i], NULL, concurrent_producer, &args[i]);
+		pthread_create(&consumers[i], NULL, concurrent_consumer, &args[i]);
+	}
+	for (i = 0; i < CONCURRENT_THREADS; i++) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+	}
+	for (i = 0; i < total; i++)
+		if (seen[i] != 1)
+			wrong++;
+	printf("Polled elements: %d (expected %d)\n", taken, total);
+	printf("Lost or duplicated: %d (expected 0)\n", wrong);
+	printf("Remaining: %d (expected 0)\n\n", cpriqueue_size(&q));
+	cpriqueue_destroy(&q);
+}
+
+int compare_uint(const void * a, const void * b)
+{
+	unsigned int l = *(unsigned int *)a, r = *(unsigned int *)b;
+	return (l > r) - (l < r);
+}
+
+double seconds_since(struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void report(const char *name, const char *op, struct timespec *start, int ops)
+{
+	double secs = seconds_since(start);
+	printf("%-7s %-8s %10d ops %10.1f ns/op\n", name, op, ops, ops > 0 ? secs * 1e9 / ops : 0.0);
+}
+
+/* Push n elements through offer/poll/remove/destroy and time each phase. */
+void stress_backend(priqueue_backend_t backend, const char *name, int *values, int n)
+{
+	priqueue_t q;
+	struct timespec start;
+	int i;
+	int polls = n / 2;
+	int removes = n - polls < 100 ? n - polls : 100; /* each remove scans the whole queue */
+
+	init_queue(&q, compare1, backend);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_offer(&q, &values[i]);
+	report(name, "offer", &start, n);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < polls; i++)
+		priqueue_poll(&q);
+	report(name, "poll", &start, polls);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < removes; i++)
+		priqueue_remove(&q, &values[n - 1 - i]);
+	report(name, "remove", &start, removes);
+
+	if (priqueue_size(&q) != n - polls - removes)
+		printf("%-7s size %d (expected %d)\n", name, priqueue_size(&q), n - polls - removes);
+
+	int remaining = priqueue_size(&q);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	priqueue_destroy(&q);
+	report(name, "destroy", &start, remaining);
+
+	/* the same n elements, reversed, as one batch */
+	void **batch = malloc(n * sizeof(void *));
+	for (i = 0; i < n; i++)
+		batch[i] = &values[n - 1 - i];
+
+	init_queue(&q, compare1, backend);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	priqueue_offer_many(&q, batch, n);
+	report(name, "bulk", &start, n);
+
+	priqueue_destroy(&q);
+	free(batch);
+}
+
+void stress(int n)
+{
+	int *values = malloc(n * sizeof(int));
+	int i;
+
+	for (i = 0; i < n; i++)
+		values[i] = i;
+
+	printf("Stress test with %d elements:\n", n);
+	stress_backend(PRIQUEUE_LIST, "list", values, n);
+	stress_backend(PRIQUEUE_HEAP, "heap", values, n);
+	stress_backend(PRIQUEUE_TREE, "tree", values, n);
+	stress_backend(PRIQUEUE_BUCKET, "bucket", values, n);
+	stress_backend(PRIQUEUE_MINMAX, "minmax", values, n);
+	stress_backend(PRIQUEUE_PAIRING, "pairing", values, n);
+
+	free(values);
+}
+
+/* Offer then poll n random ints through the generic heap and the typed heap. */
+void bench(int n)
+{
+	int *values = malloc(n * sizeof(int));
+	priqueue_t generic;
+	int_queue_t typed;
+	struct timespec start;
+	int i;
+
+	srand(678);
+	for (i = 0; i < n; i++)
+		values[i] = rand();
+
+	printf("Generic vs keyed vs typed heap with %d elements:\n", n);
+
+	priqueue_init_backend(&generic, compare1, PRIQUEUE_HEAP);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_offer(&generic, &values[i]);
+	report("heap", "offer", &start, n);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_poll(&generic);
+	report("heap", "poll", &start, n);
+	priqueue_destroy(&generic);
+
+	priqueue_init_keyed(&generic, sort_key1, PRIQUEUE_HEAP);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_offer(&generic, &values[i]);
+	report("keyed", "offer", &start, n);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		priqueue_poll(&generic);
+	report("keyed", "poll", &start, n);
+	priqueue_destroy(&generic);
+
+	int_queue_init(&typed);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		int_queue_offer(&typed, &values[i]);
+	report("typed", "offer", &start, n);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++)
+		int_queue_poll(&typed);
+	report("typed", "poll", &start, n);
+	int_queue_destroy(&typed);
+
+	free(values);
+}
+
+/*
+  Discrete-event "hold" workload: keep m events pending, and n times pop the
+  earliest and schedule a new one at its time plus a random delay.
+*/
+void events_backend(priqueue_backend_t backend, const char *name, unsigned int *times, unsigned int *delays, int n, int m)
+{
+	priqueue_t q;
+	struct timespec start;
+	int i;
+
+	priqueue_init_backend(&q, compare_uint, backend);
+	for (i = 0; i < m; i++)
+		priqueue_offer(&q, &times[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++) {
+		unsigned int *event = priqueue_poll(&q);
+		*event += delays[i];
+		priqueue_offer(&q, event);
+	}
+	report(name, "hold", &start, n);
+
+	priqueue_destroy(&q);
+}
+
+void events_radix(unsigned int *times, unsigned int *delays, int n, int m)
+{
+	radix_heap_t h;
+	struct timespec start;
+	unsigned int now;
+	int i;
+
+	radix_heap_init(&h);
+	for (i = 0; i < m; i++)
+		radix_heap_offer(&h, times[i], &times[i]);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < n; i++) {
+		unsigned int *event = radix_heap_poll(&h, &now);
+		*event = now + delays[i];
+		radix_heap_offer(&h, *event, event);
+	}
+	report("radix", "hold", &start, n);
+
+	radix_heap_destroy(&h);
+}
+
+typedef struct
+{
+	cpriqueue_t *mq;
+	pthread_mutex_t *lock;
+	priqueue_t *q;
+	int ops;
+	unsigned int seed;
+} scaling_arg_t;
+
+/* hold model: take an element, push its key back by a random amount, put it back */
+void *scaling_worker(void *arg)
+{
+	scaling_arg_t *a = arg;
+	int i;
+
+	for (i = 0; i < a->ops; i++) {
+		int *item;
+		if (a->mq != NULL) {
+			item = cpriqueue_poll(a->mq);
+			if (item == NULL)
+				continue;
+			*item += rand_r(&a->seed) % 1000;
+			cpriqueue_offer(a->mq, item);
+		}
+		else {
+			pthread_mutex_lock(a->lock);
+			item = priqueue_poll(a->q);
+			*item += rand_r(&a->seed) % 1000;
+			priqueue_offer(a->q, item);
+			pthread_mutex_unlock(a->lock);
+		}
+	}
+	return NULL;
+}
+
+void scaling_run(int multiqueue, int threads, int *values, int n, int m)
+{
+	cpriqueue_t mq;
+	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	priqueue_t q;
+	pthread_t *tids = malloc(threads * sizeof(pthread_t));
+	scaling_arg_t *args = malloc(threads * sizeof(scaling_arg_t));
+	struct timespec start;
+	char label[16];
+	int i;
+
+	if (multiqueue)
+		cpriqueue_init(&mq, compare1, 2 * threads);
+	else
+		priqueue_init_backend(&q, compare1, PRIQUEUE_HEAP);
+	for (i = 0; i < m; i++) {
+		values[i] = rand() % 1000;
+		if (multiqueue)
+			cpriqueue_offer(&mq, &values[i]);
+		else
+			priqueue_offer(&q, &values[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < threads; i++) {
+		args[i].mq = multiqueue ? &mq : NULL;
+		args[i].lock = &lock;
+		args[i].q = &q;
+		args[i].ops = n / threads;
+		args[i].seed = i + 1;
+		pthread_create(&tids[i], NULL, scaling_worker, &args[i]);
+	}
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	snprintf(label, sizeof(label), "%d thr", threads);
+	report(multiqueue ? "multiq" : "locked", label, &start, n / threads * threads);
+
+	if (multiqueue)
+		cpriqueue_destroy(&mq);
+	else
+		priqueue_destroy(&q);
+	free(tids);
+	free(args);
+}
+
+void scaling(int n, int m)
+{
+	int *values = malloc(m * sizeof(int));
+	int threads;
+
+	srand(678);
+	printf("Concurrent hold model, %d operations over %d pending:\n", n, m);
+
+	/* a multi-queue with two lanes per thread against one mutex around a heap */
+	for (threads = 1; threads <= 64; threads *= 2) {
+		scaling_run(0, threads, values, n, m);
+		scaling_run(1, threads, values, n, m);
+	}
+
+	free(values);
+}
+
+void events(int n, int m)
+{
+	unsigned int *initial = malloc(m * sizeof(unsigned int));
+	unsigned int *times = malloc(m * sizeof(unsigned int));
+	unsigned int *delays = malloc(n * sizeof(unsigned int));
+	int i;
+
+	srand(678);
+	for (i = 0; i < m; i++)
+		initial[i] = rand() % 1000;
+	for (i = 0; i < n; i++)
+		delays[i] = rand() % 1000;
+
+	printf("Event simulation, %d events over %d pending:\n", n, m);
+
+	/* every queue starts from the same pending set */
+	/* each list offer walks the pending set, so leave it out of big runs */
+	memcpy(times, initial, m * sizeof(unsigned int));
+	if (m <= 10000)
+		events_backend(PRIQUEUE_LIST, "list", times, delays, n, m);
+	else
+		printf("%-7s skipped with more than 10000 pending\n", "list");
+	memcpy(times, initial, m * sizeof(unsigned int));
+	events_backend(PRIQUEUE_HEAP, "heap", times, delays, n, m);
+	memcpy(times, initial, m * sizeof(unsigned int));
+	events_radix(times, delays, n, m);
+
+	free(initial);
+	free(times);
+	free(delays);
+}
+
+int main(int argc, char **argv)
+{
+	/* ./queuetest stress [n] */
+	if (argc > 1 && strcmp(argv[1], "stress") == 0) {
+		stress(argc > 2 ? atoi(argv[2]) : 10000000);
+		return 0;
+	}
+
+	/* ./queuetest events [n] [pending] */
+	if (argc > 1 && strcmp(argv[1], "events") == 0) {
+		events(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 1000);
+		return 0;
+	}
+
+	/* ./queuetest threads [n] [pending] */
+	if (argc > 1 && strcmp(argv[1], "threads") == 0) {
+		scaling(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 10000);
+		return 0;
+	}
+
+	/* ./queuetest bench [n] */
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		bench(argc > 2 ? atoi(argv[2]) : 1000000);
+		return 0;
+	}
+
+	test_backend(PRIQUEUE_LIST, "list");
+	test_backend(PRIQUEUE_HEAP, "heap");
+	test_backend(PRIQUEUE_TREE, "tree");
+	test_backend(PRIQUEUE_BUCKET, "bucket");
+	test_backend(PRIQUEUE_MINMAX, "minmax");
+	test_backend(PRIQUEUE_PAIRING, "pairing");
+	test_intrusive();
+	test_typed();
+	test_keyed(PRIQUEUE_HEAP, "heap");
+	test_keyed(PRIQUEUE_MINMAX, "minmax");
+	test_radix();
+#ifdef PRIQUEUE_STATS
+	test_stats(PRIQUEUE_LIST, "list");
+	test_stats(PRIQUEUE_HEAP, "heap");
+	test_stats(PRIQUEUE_TREE, "tree");
+	test_stats(PRIQUEUE_BUCKET, "bucket");
+	test_stats(PRIQUEUE_MINMAX, "minmax");
+	test_stats(PRIQUEUE_PAIRING, "pairing");
+#endif
+	test_concurrent();
 
 	return 0;
 }
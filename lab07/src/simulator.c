@@ -23,7 +23,7 @@ void print_usage(char *program_name)
 	fprintf(stderr, "Usage: %s -c <cores> -s <scheme> <input file>\n", program_name);
 	fprintf(stderr, "       %s -c 2 -s fcfs examples/proc1.csv\n", program_name);
 	fprintf(stderr, "\n");
-	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#\n");
+	fprintf(stderr, "Acceptable schemes are: fcfs, sjf, psjf, pri, ppri, rr#, mlfq[#,#,...]\n");
 }
 
 int set_active_job(int job_id, int core_id, simulator_job_list_t *jobs, int active_jobs)
@@ -83,6 +83,7 @@ int main(int argc, char **argv)
 {
 	int c;
 	int cores = 0, scheme = -1, quantum = 0;
+	int mlfq_levels = 0, mlfq_quanta[MLFQ_MAX_LEVELS];
 	char *file_name;
 
 	/*
@@ -121,6 +122,31 @@ int main(int argc, char **argv)
 						return 1;
 					}
 				}
+				else if (strncasecmp(optarg, "MLFQ", 4) == 0)
+				{
+					// the scheduler tracks each level's quantum itself, so it hears
+					// about every time unit
+					scheme = MLFQ;
+					quantum = 1;
+
+					// optional quanta, one per level (Eg: -s MLFQ2,4,8)
+					char *level = optarg + 4;
+					while (*level != '\0')
+					{
+						char *end;
+						long level_quantum = strtol(level, &end, 10);
+
+						if (level_quantum <= 0 || end == level || (*end != ',' && *end != '\0') || mlfq_levels == MLFQ_MAX_LEVELS)
+						{
+							fprintf(stderr, "Option -s <scheme> requires up to %d positive quanta for the levels of MLFQ. (Eg: -s MLFQ2,4,8)\n", MLFQ_MAX_LEVELS);
+							print_usage(argv[0]);
+							return 1;
+						}
+
+						mlfq_quanta[mlfq_levels++] = level_quantum;
+						level = *end == ',' ? end + 1 : end;
+					}
+				}
 				break;
 
 			case '?':
@@ -224,9 +250,18 @@ int main(int argc, char **argv)
 	else if (scheme == PRI) { printf("Non-preemptive Priority (PRI)"); }
 	else if (scheme == PPRI) { printf("Preemptive Priority (PPRI)"); }
 	else if (scheme == RR) { printf("Round Robin (RR) with a quantum of %d", quantum); }
+	else if (scheme == MLFQ)
+	{
+		int level;
+		printf("Multi-level Feedback Queue (MLFQ)");
+		for (level = 0; level < mlfq_levels; level++)
+			printf(level == 0 ? " with quanta of %d" : ",%d", mlfq_quanta[level]);
+	}
 	printf(" scheduling...\n\n");
 
 	scheduler_start_up(cores, scheme);
+	if (mlfq_levels > 0)
+		scheduler_set_mlfq(mlfq_levels, mlfq_quanta, MLFQ_DEFAULT_BOOST_PERIOD);
 
 
 	int time = 0, i, j;
@@ -259,7 +294,7 @@ int main(int argc, char **argv)
 				int core_id = jobs[i].core_id;
 				int new_job_id = scheduler_job_finished(jobs[i].core_id, jobs[i].job_id, time);
 
-				if (scheme == RR)
+				if (scheme == RR || scheme == MLFQ)
 					quantum_clock[jobs[i].core_id] = quantum;
 
 				// Delete the finished jobs, decrease the number of active jobs
@@ -293,7 +328,7 @@ int main(int argc, char **argv)
 		/*
 		 * 2. Check of any quantums expired in the last time unit.
 		 */
-		if (scheme == RR)
+		if (scheme == RR || scheme == MLFQ)
 		{
 			for (i = 0; i < cores; i++)
 			{
@@ -319,7 +354,7 @@ int main(int argc, char **argv)
 								print_available_jobs(jobs, active_jobs);
 								return 3;
 							}
-							else
+							else if (scheme != MLFQ || new_job_id != old_job_id) // MLFQ's time units pass quietly until its quantum is up
 							{
 								printf("Job %d, running on core %d, had its quantum expire. Core %d is now running job %d.\n", old_job_id, core_id, core_id, new_job_id);
 								printf("  Queue: "); scheduler_show_queue(); printf("\n\n");
@@ -358,7 +393,7 @@ int main(int argc, char **argv)
 					// Assign the core to the new job
 					jobs[i].core_id = new_job_core_id;
 
-					if (scheme == RR)
+					if (scheme == RR || scheme == MLFQ)
 						quantum_clock[new_job_core_id] = quantum;
 				}
 				else if (new_job_core_id == -1)
@@ -479,6 +514,11 @@ int main(int argc, char **argv)
 	printf("Average Turnaround Time: %.2f\n", scheduler_average_turnaround_time());
 	printf("Average Response Time: %.2f\n", scheduler_average_response_time());
 
+#ifdef PRIQUEUE_STATS
+	printf("\n");
+	scheduler_show_queue_stats();
+#endif
+
 	scheduler_clean_up();
 
 